@@ -13,36 +13,13 @@ namespace Backend {
 
 // class Gate
 
-class Gate::GateImpl : public arma::cx_mat22 {
-  public:
-    using arma::cx_mat22::cx_mat22;
-};
-
-Gate::Gate(const Gate& other):
-  pImpl(make_unique<GateImpl>(other.impl()))
-{ }
-
-Gate::Gate(GateImpl&& otherImpl):
-  pImpl(make_unique<GateImpl>(std::move(otherImpl)))
-{ }
-
-Gate::Gate(cxd u11, cxd u12, cxd u21, cxd u22):
-  pImpl(make_unique<GateImpl>(
-        std::initializer_list<cxd>{u11, u12, u21, u22}))
-{ }
-
-Gate::~Gate() { }
-
-const Gate::GateImpl& Gate::impl() const {
-  return *pImpl;
-}
-
-Gate operator*(const Gate& lhs, const Gate& rhs) {
-  return {lhs.impl() * rhs.impl()};
-}
-
-std::complex<double> Gate::operator() (size_t rix, size_t cix) {
-  return impl()(rix, cix);
+// The matrix of a Gate as Armadillo's type
+static arma::cx_mat22 gate_mat(const Gate& gate) {
+  arma::cx_mat22 ret;
+  for(arma::uword r = 0; r < 2; r++)
+    for(arma::uword c = 0; c < 2; c++)
+      ret(r, c) = gate(r, c);
+  return ret;
 }
 
 
@@ -65,91 +42,15 @@ const Gate Si { 1, 0, 0, -i };
 
 // class Controls
 
-class Controls::ControlsImpl : public arma::uvec {
-
-  public:
-    using arma::uvec::uvec;
-
-  const arma::uvec& rep() const {
-    return static_cast<const arma::uvec&>(*this);
-  }
-
-};
-
-static std::vector<arma::uword> ix_vector(const std::vector<bool>& bits) {
-  std::vector<arma::uword> ret{};
-  for(unsigned i = 0; i < Config::nBit; i++)
-    if(bits[i])
-      ret.push_back(i + 1);
+// The controls as QIClib's list of 1-based indices
+static arma::uvec ctrl_list(const Controls& ixs) {
+  std::vector<unsigned> v = ixs.as_vector();
+  arma::uvec ret(v.size());
+  for(size_t j = 0; j < v.size(); j++)
+    ret[j] = v[j] + 1;
   return ret;
 }
 
-Controls::Controls():
-  pImpl(make_unique<ControlsImpl>())
-{ }
-
-Controls::Controls(const Controls& other):
-  pImpl(make_unique<ControlsImpl>(other.impl()))
-{ }
-
-Controls::Controls(ControlsImpl&& otherImpl):
-  pImpl(make_unique<ControlsImpl>(std::move(otherImpl)))
-{ }
-
-Controls::Controls(const std::vector<bool>& bits):
-  pImpl(make_unique<ControlsImpl>(ix_vector(bits)))
-{ }
-
-Controls::~Controls() { }
-
-const Controls::ControlsImpl& Controls::impl() const {
-  return *pImpl;
-}
-
-Controls& Controls::operator=(const Controls& other) {
-  pImpl = make_unique<ControlsImpl>(other.impl());
-  return *this;
-}
-
-Controls& Controls::operator=(Controls&& other) {
-  pImpl = make_unique<ControlsImpl>(std::move(other.impl()));
-  return *this;
-}
-
-bool operator==(const Controls& lhs, const Controls& rhs) {
-  return lhs.size() == rhs.size() &&
-    arma::all(lhs.impl().rep() == rhs.impl().rep());
-}
-
-size_t Controls::size() const {
-  return impl().size();
-}
-
-std::vector<unsigned> Controls::as_vector() const {
-  std::vector<unsigned> ret{};
-  ret.reserve(size());
-  for(auto ix : impl())
-    ret.push_back(ix - 1);
-  return ret;
-}
-
-Controls Controls::swapGate(unsigned s1, unsigned s2) {
-  arma::uvec ret(Config::nBit);
-  for(unsigned i = 0; i < Config::nBit; i++)
-    ret[i] = i + 1;
-  ret[s1] = s2 + 1;
-  ret[s2] = s1 + 1;
-  return {std::move(ret)};
-}
-
-Controls Controls::swapQubits(const Controls& orig, unsigned s1, unsigned s2) {
-  arma::uvec vector{orig.impl().rep()};
-  for(auto&& v : vector)
-    v = v == s1 + 1 ? s2 + 1 : v == s2 + 1 ? s1 + 1 : v;
-  std::sort(vector.begin(), vector.end());
-  return {std::move(vector)};
-}
-
 
 // class State
 
@@ -228,14 +129,53 @@ State State::apply_ctrl(
 {
   return {qic::apply_ctrl(
       impl().rep(),
-      gate.impl(),
-      ixs.impl(),
+      gate_mat(gate),
+      ctrl_list(ixs),
       {tgt + 1}
     )};
 }
 
-State State::swapQubits(const Controls& ixs) const {
-  return {qic::sysperm(impl().rep(), ixs.impl())};
+// mat is a row-major 2^k × 2^k matrix acting on the k given qubits
+State State::apply_block(
+    const std::vector<cxd>& mat,
+    const std::vector<unsigned>& qubits) const
+{
+  arma::uword bd = arma::uword(1) << qubits.size();
+  arma::cx_mat op(bd, bd);
+  for(arma::uword r = 0; r < bd; r++)
+    for(arma::uword c = 0; c < bd; c++)
+      op(r, c) = mat[r * bd + c];
+  arma::uvec sys(qubits.size());
+  for(size_t j = 0; j < qubits.size(); j++)
+    sys[j] = qubits[j] + 1;
+  return {qic::apply(impl().rep(), op, sys)};
+}
+
+State State::swapQubits(unsigned s1, unsigned s2) const {
+  arma::uvec perm(Config::nBit);
+  for(unsigned i = 0; i < Config::nBit; i++)
+    perm[i] = i + 1;
+  perm[s1] = s2 + 1;
+  perm[s2] = s1 + 1;
+  return {qic::sysperm(impl().rep(), perm)};
+}
+
+// mat is row-major, ctrls may contain any number of bits, tgt exactly one
+void State::apply_ctrl_mask(const cxd (&mat)[4], size_t ctrls, size_t tgt) {
+  cxd* data = impl().memptr();
+  for(size_t i = 0; i < dim(); i++)
+    if(!(i & tgt) && (i & ctrls) == ctrls) {
+      cxd a = data[i], b = data[i | tgt];
+      data[i] = mat[0] * a + mat[1] * b;
+      data[i | tgt] = mat[2] * a + mat[3] * b;
+    }
+}
+
+void State::swap_mask(size_t m1, size_t m2) {
+  cxd* data = impl().memptr();
+  for(size_t i = 0; i < dim(); i++)
+    if((i & m1) && !(i & m2))
+      std::swap(data[i], data[i ^ m1 ^ m2]);
 }
 
 std::ostream& operator<< (std::ostream& os, const State& state) {
@@ -247,6 +187,10 @@ cxd& State::operator[](size_t index) {
   return impl()[index];
 }
 
+cxd State::operator[](size_t index) const {
+  return impl()[index];
+}
+
 } // namespace Backend
 
 } // namespace QGA
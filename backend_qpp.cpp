@@ -11,43 +11,15 @@ namespace Backend {
 
 // class Gate
 
-class Gate::GateImpl : public Eigen::Matrix2cd {
-  
-  public:
-    using Eigen::Matrix2cd::Matrix2cd;
-
-  Eigen::Matrix2cd& rep() {
-    return static_cast<Eigen::Matrix2cd&>(*this);
-  }
-
-};
-
-Gate::Gate(const Gate& other):
-  pImpl(make_unique<GateImpl>(other.impl()))
-{ }
-
-Gate::Gate(GateImpl&& otherImpl):
-  pImpl(make_unique<GateImpl>(std::move(otherImpl)))
-{ }
-
-Gate::Gate(cxd u11, cxd u12, cxd u21, cxd u22):
-  pImpl(make_unique<GateImpl>(2, 2))
-{
-  pImpl->rep() << u11, u12, u21, u22;
-}
-
-Gate::~Gate() { }
-
-const Gate::GateImpl& Gate::impl() const {
-  return *pImpl;
-}
-
-Gate operator*(const Gate& lhs, const Gate& rhs) {
-  return {lhs.impl() * rhs.impl()};
+// The matrix of a Gate as Eigen's type
+static Eigen::Matrix2cd gate_mat(const Gate& gate) {
+  Eigen::Matrix2cd ret;
+  ret << gate(0, 0), gate(0, 1), gate(1, 0), gate(1, 1);
+  return ret;
 }
 
-std::complex<double> Gate::operator() (size_t rix, size_t cix) {
-  return impl()(rix, cix);
+static Gate from_mat(const Eigen::Matrix2cd& mat) {
+  return {mat(0, 0), mat(0, 1), mat(1, 0), mat(1, 1)};
 }
 
 
@@ -57,103 +29,23 @@ using QGA::Const::i;
 using QGA::Const::pi;
 using QGA::Const::v12;
 
-const Gate I { qpp::gt.Id2 };
-const Gate H { qpp::gt.H };
-const Gate X { qpp::gt.X };
-const Gate Y { qpp::gt.Y };
-const Gate Z { qpp::gt.Z };
-const Gate T { qpp::gt.T };
-const Gate Ti { qpp::gt.T.conjugate() };
-const Gate S { qpp::gt.S };
-const Gate Si { qpp::gt.S.conjugate() };
+const Gate I = from_mat(qpp::gt.Id2);
+const Gate H = from_mat(qpp::gt.H);
+const Gate X = from_mat(qpp::gt.X);
+const Gate Y = from_mat(qpp::gt.Y);
+const Gate Z = from_mat(qpp::gt.Z);
+const Gate T = from_mat(qpp::gt.T);
+const Gate Ti = from_mat(qpp::gt.T.conjugate());
+const Gate S = from_mat(qpp::gt.S);
+const Gate Si = from_mat(qpp::gt.S.conjugate());
 
 
 // class Controls
 
-class Controls::ControlsImpl : public std::vector<qpp::idx> {
-
-  public:
-    using std::vector<qpp::idx>::vector;
-
-  ControlsImpl() = default;
-
-  ControlsImpl(std::vector<qpp::idx>&& other):
-    std::vector<qpp::idx>(std::move(other))
-  { }
-
-  const std::vector<qpp::idx>& rep() const {
-    return static_cast<const std::vector<qpp::idx>&>(*this);
-  }
-
-};
-
-Controls::Controls():
-  pImpl(make_unique<ControlsImpl>())
-{ }
-
-Controls::Controls(const Controls& other):
-  pImpl(make_unique<ControlsImpl>(other.impl()))
-{ }
-
-Controls::Controls(ControlsImpl&& otherImpl):
-  pImpl(make_unique<ControlsImpl>(std::move(otherImpl)))
-{ }
-
-Controls::Controls(const std::vector<bool>& bits):
-  pImpl(make_unique<ControlsImpl>())
-{
-  for(unsigned i = 0; i < Config::nBit; i++)
-    if(bits[i])
-      pImpl->push_back(i);
-}
-
-Controls::~Controls() { }
-
-const Controls::ControlsImpl& Controls::impl() const {
-  return *pImpl;
-}
-
-Controls& Controls::operator=(const Controls& other) {
-  pImpl = make_unique<ControlsImpl>(other.impl());
-  return *this;
-}
-
-Controls& Controls::operator=(Controls&& other) {
-  pImpl = make_unique<ControlsImpl>(std::move(other.impl()));
-  return *this;
-}
-
-bool operator==(const Controls& lhs, const Controls& rhs) {
-  return lhs.impl() == rhs.impl();
-}
-
-size_t Controls::size() const {
-  return impl().size();
-}
-
-std::vector<unsigned> Controls::as_vector() const {
-  std::vector<unsigned> ret{};
-  ret.reserve(size());
-  for(auto ix : impl())
-    ret.push_back(ix);
-  return ret;
-}
-
-Controls Controls::swapGate(unsigned s1, unsigned s2) {
-  std::vector<qpp::idx> ret(Config::nBit);
-  for(unsigned i = 0; i < Config::nBit; i++)
-    ret[i] = i;
-  ret[s1] = s2;
-  ret[s2] = s1;
-  return {std::move(ret)};
-}
-
-Controls Controls::swapQubits(const Controls& orig, unsigned s1, unsigned s2) {
-  std::vector<qpp::idx> vector{orig.impl().rep()};
-  for(auto&& v : vector)
-    v = v == s1 ? s2 : v == s2 ? s1 : v;
-  std::sort(vector.begin(), vector.end());
-  return {std::move(vector)};
+// The controls as Quantum++'s list of indices
+static std::vector<qpp::idx> ctrl_list(const Controls& ixs) {
+  std::vector<unsigned> v = ixs.as_vector();
+  return {v.begin(), v.end()};
 }
 
 
@@ -235,11 +127,46 @@ State State::apply_ctrl(
     const Controls& ixs,
     unsigned tgt) const
 {
-  return {qpp::applyCTRL(impl(), mat.impl(), ixs.impl(), {tgt})};
+  return {qpp::applyCTRL(impl(), gate_mat(mat), ctrl_list(ixs), {tgt})};
 }
 
-State State::swapQubits(const Controls& ixs) const {
-  return {qpp::syspermute(impl(), ixs.impl())};
+// mat is a row-major 2^k × 2^k matrix acting on the k given qubits
+State State::apply_block(
+    const std::vector<cxd>& mat,
+    const std::vector<unsigned>& qubits) const
+{
+  Eigen::Index bd = Eigen::Index(1) << qubits.size();
+  qpp::cmat op = Eigen::Map<const Eigen::Matrix<cxd, Eigen::Dynamic,
+    Eigen::Dynamic, Eigen::RowMajor>>(mat.data(), bd, bd);
+  std::vector<qpp::idx> target(qubits.begin(), qubits.end());
+  return {qpp::apply(impl(), op, target)};
+}
+
+State State::swapQubits(unsigned s1, unsigned s2) const {
+  std::vector<qpp::idx> perm(Config::nBit);
+  for(unsigned i = 0; i < Config::nBit; i++)
+    perm[i] = i;
+  perm[s1] = s2;
+  perm[s2] = s1;
+  return {qpp::syspermute(impl(), perm)};
+}
+
+// mat is row-major, ctrls may contain any number of bits, tgt exactly one
+void State::apply_ctrl_mask(const cxd (&mat)[4], size_t ctrls, size_t tgt) {
+  cxd* data = impl().data();
+  for(size_t i = 0; i < size_t(impl().size()); i++)
+    if(!(i & tgt) && (i & ctrls) == ctrls) {
+      cxd a = data[i], b = data[i | tgt];
+      data[i] = mat[0] * a + mat[1] * b;
+      data[i | tgt] = mat[2] * a + mat[3] * b;
+    }
+}
+
+void State::swap_mask(size_t m1, size_t m2) {
+  cxd* data = impl().data();
+  for(size_t i = 0; i < size_t(impl().size()); i++)
+    if((i & m1) && !(i & m2))
+      std::swap(data[i], data[i ^ m1 ^ m2]);
 }
 
 std::ostream& operator<< (std::ostream& os, const State& state) {
@@ -252,6 +179,10 @@ cxd& State::operator[](size_t index) {
   return impl()[index];
 }
 
+cxd State::operator[](size_t index) const {
+  return impl()[index];
+}
+
 } // namespace Backend
 
 } // namespace QGA
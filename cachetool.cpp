@@ -0,0 +1,98 @@
+#include <iostream>
+#include <fstream>
+#include <map>
+
+#include "QGA_commons.hpp"
+#include "MappedFile.hpp"
+#include "QGA_bits/DiskCache.hpp"
+
+/* Inspection and maintenance of persistent fitness caches (see --cache).
+ *
+ *   cachetool stats FILE
+ *     lists the number of entries per problem and qubit count,
+ *
+ *   cachetool compact FILE OUTPUT [SLOTS]
+ *     copies all complete entries to a new file with a given number of slots
+ *     (default: twice the number of entries), rounded up to a power of 2.
+ *
+ * Don't compact a file which is in use by a running evolution: its entries
+ * added after the copy started would be lost. */
+
+using QGA::DiskCache;
+
+int usage() {
+  std::cerr << "Usage:\n"
+    << "  cachetool stats FILE\n"
+    << "  cachetool compact FILE OUTPUT [SLOTS]\n";
+  return 1;
+}
+
+std::string problemName(const DiskCache::Header& h, std::uint32_t tag) {
+  for(unsigned i = 0; i < h.nNames; i++)
+    if(h.tags[i] == tag)
+      return h.names[i];
+  return "?";
+}
+
+int stats(const DiskCache& cache) {
+  const DiskCache::Header& h = cache.info();
+  std::map<std::pair<std::string, unsigned>, size_t> counts{};
+  size_t total = 0;
+  cache.forEach([&](const DiskCache::Entry& e) {
+      counts[{problemName(h, e.tag), e.nBit}]++;
+      total++;
+    });
+  std::cout << "Capacity: " << h.capacity << " slots\n"
+    << "Claimed:  " << h.count << " slots ("
+    << std::fixed << std::setprecision(1) << 100.0 * h.count / h.capacity
+    << "% load)\n"
+    << "Complete: " << total << " entries\n";
+  for(auto& c : counts)
+    std::cout << "  " << c.first.first << ", " << c.first.second
+      << " qubits: " << c.second << '\n';
+  return 0;
+}
+
+int compact(const DiskCache& cache, const std::string& output, size_t slots) {
+  if(slots == 0)
+    slots = 2 * cache.info().count;
+  size_t cap = 1024;
+  while(cap < slots)
+    cap *= 2;
+  if(std::ifstream{output}) {
+    std::cerr << output << " exists, not overwriting\n";
+    return 1;
+  }
+  DiskCache out{output, "", cap};
+  out.copyNames(cache);
+  size_t total = 0, lost = 0;
+  cache.forEach([&](const DiskCache::Entry& e) {
+      if(out.insert(e))
+        total++;
+      else
+        lost++;
+    });
+  std::cout << total << " entries copied to " << output << " ("
+    << out.info().capacity << " slots)\n";
+  if(lost > 0)
+    std::cout << lost << " entries did not fit\n";
+  return lost > 0 ? 1 : 0;
+}
+
+int main(int argc, char* argv[]) {
+  if(argc < 3)
+    return usage();
+  std::string cmd{argv[1]};
+  try {
+    DiskCache cache{argv[2]};
+    if(cmd == "stats" && argc == 3)
+      return stats(cache);
+    else if(cmd == "compact" && (argc == 4 || argc == 5))
+      return compact(cache, argv[3], argc == 5 ? std::stoul(argv[4]) : 0);
+    else
+      return usage();
+  } catch(const std::exception& e) {
+    std::cerr << e.what() << '\n';
+    return 1;
+  }
+}
@@ -0,0 +1,112 @@
+#ifndef MAPPED_FILE_HPP
+#define MAPPED_FILE_HPP
+
+#include <string>
+#include <cstring>
+#include <cerrno>
+#include <stdexcept>
+#include <stddef.h>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+/* A shared memory mapping of a whole file. If opened for writing, the file is
+ * created if needed, and if empty, extended (with zeros) to minSize bytes. The
+ * mapping is MAP_SHARED so several processes opening the same file see each
+ * other's writes. lock() and unlock() provide an advisory whole-file lock
+ * for operations which need to be exclusive across processes. */
+
+class MappedFile {
+
+public:
+
+  MappedFile() = default;
+
+  MappedFile(const std::string& name, bool writable, size_t minSize = 0) {
+    fd = ::open(name.c_str(), writable ? O_RDWR | O_CREAT : O_RDONLY, 0644);
+    if(fd < 0)
+      fail("open", name);
+    struct stat st;
+    if(writable) {
+      lock();
+      if(::fstat(fd, &st) < 0)
+        fail("stat", name);
+      if(st.st_size == 0 && ::ftruncate(fd, minSize) < 0)
+        fail("resize", name);
+      unlock();
+    }
+    if(::fstat(fd, &st) < 0)
+      fail("stat", name);
+    len = st.st_size;
+    if(len == 0)
+      return;
+    ptr = ::mmap(nullptr, len, writable ? PROT_READ | PROT_WRITE : PROT_READ,
+        MAP_SHARED, fd, 0);
+    if(ptr == MAP_FAILED) {
+      ptr = nullptr;
+      fail("map", name);
+    }
+  }
+
+  MappedFile(const MappedFile&) = delete;
+
+  MappedFile(MappedFile&& other): ptr(other.ptr), len(other.len), fd(other.fd) {
+    other.ptr = nullptr;
+    other.fd = -1;
+  }
+
+  MappedFile& operator=(MappedFile&& other) {
+    std::swap(ptr, other.ptr);
+    std::swap(len, other.len);
+    std::swap(fd, other.fd);
+    return *this;
+  }
+
+  ~MappedFile() {
+    if(ptr)
+      ::munmap(ptr, len);
+    if(fd >= 0)
+      ::close(fd);
+  }
+
+  void* data() const {
+    return ptr;
+  }
+
+  size_t size() const {
+    return len;
+  }
+
+  explicit operator bool() const {
+    return ptr != nullptr;
+  }
+
+  void lock() {
+    ::flock(fd, LOCK_EX);
+  }
+
+  void unlock() {
+    ::flock(fd, LOCK_UN);
+  }
+
+private:
+
+  [[noreturn]] void fail(const char* what, const std::string& name) {
+    std::string msg = std::string("Can't ") + what + " " + name + ": "
+      + std::strerror(errno);
+    if(fd >= 0)
+      ::close(fd);
+    fd = -1;
+    throw std::runtime_error(msg);
+  }
+
+  void* ptr = nullptr;
+  size_t len = 0;
+  int fd = -1;
+
+}; // class MappedFile
+
+#endif // !defined MAPPED_FILE_HPP
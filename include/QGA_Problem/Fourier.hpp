@@ -6,7 +6,15 @@ namespace {
 
 using QGA::Backend::State;
 
-using Gene = QGA::Gene<QGA::Gates::Y, QGA::Gates::CPhase, QGA::Gates::SWAP>;
+// The QFT on n+1 qubits contains the QFT on n qubits shifted by one
+using Gene = QGA::Gene<
+               QGA::Gates::Y::WithLift<QGA::Lift::SHIFT>,
+               QGA::Gates::CPhase::WithLift<QGA::Lift::SHIFT>,
+               QGA::Gates::SWAP::WithLift<QGA::Lift::SHIFT>
+#ifdef MODULES
+               , QGA::Gates::Module
+#endif
+             >;
 
 
 class Candidate : public QGA::CandidateBase<Candidate, Gene, double, size_t> {
@@ -17,24 +25,83 @@ public:
 
   using Base::Base;
 
-  Base::Fitness fitness() const {
-    if(genotype().size() > 1000)
-      return {};
-    using cxd = std::complex<double>;
-    cxd overlapTotal{0};
+  // Identifies the problem in persistent caches
+  static const char* name() {
+    return "fourier";
+  }
+
+  // Tabulate the columns of the discrete Fourier transform
+  static void precompute() {
+    Base::precompute();
     unsigned dim = 1 << Config::nBit;
-    State psi{};
+    std::vector<Channel>& tab = channelTable();
+    tab.clear();
+    tab.reserve(dim);
     for(unsigned i = 0; i < dim; i++) {
-      psi.reset(i);
+      State psi{i};
       State out = State::fourier(psi);
-      cxd overlap = State::overlap(out, sim(psi));
-      overlapTotal += overlap;
+      tab.push_back({std::move(psi), std::move(out), nullptr});
     }
-    double errorAvg = std::max(1.0 - std::abs(overlapTotal / cxd(dim)), 0.0);
-    return {
+  }
+
+  // Basis states and their images, see CandidateBase::optimize()
+  static const std::vector<Channel>& channels() {
+    return channelTable();
+  }
+
+  // The error computed in fitness() and its differential
+  static double surrogate(const std::vector<QGA::Backend::cxd>& a,
+      std::vector<QGA::Backend::cxd>& w) {
+    QGA::Backend::cxd total{0};
+    for(auto& z : a)
+      total += z;
+    double dim = a.size(), abs = std::abs(total);
+    w.assign(a.size(), abs > 0 ? -std::conj(total) / (abs * dim) : -1 / dim);
+    return 1 - abs / dim;
+  }
+
+  Base::Fitness fitness() const {
+    if(overBudget(1 << Config::nBit))
+      return {};
+    double errorAvg = memoError([this]() -> double {
+        using cxd = std::complex<double>;
+        if(Config::estProbes > 0 && bounding()) {
+          double est = estimateError();
+          if(screen({trimError(std::max(est - Config::estMargin, 0.0)),
+                genotype().size()}))
+            return est;
+        }
+        cxd overlapTotal{0};
+        unsigned dim = 1 << Config::nBit;
+        unsigned chunk = std::max(dim / nChunks, 1u);
+        const std::vector<Channel>& tab = channels();
+        for(unsigned i = 0; i < dim; i++) {
+          if(i % chunk == 0) {
+            // Each of the remaining overlaps has an absolute value <= 1
+            double bound = 1.0 - (std::abs(overlapTotal) + (dim - i)) / dim;
+            if(tryReject({trimError(std::max(bound, 0.0)),
+                  genotype().size()}))
+              break;
+          }
+          cxd overlap = State::overlap(tab[i].target, simChannel(i));
+          overlapTotal += overlap;
+        }
+        return std::max(1.0 - std::abs(overlapTotal / cxd(dim)), 0.0);
+      });
+    if(rejected()) {
+      audit({});
+      return {};
+    }
+    Base::Fitness ret{
       trimError(errorAvg),
       genotype().size()
     };
+    audit(ret);
+    return ret;
+  }
+
+  State probe(const QGA::Fingerprint::Probe& p) const {
+    return sim(p.psi);
   }
 
   std::ostream& print_full(std::ostream& os) const {
@@ -55,10 +122,37 @@ public:
 
 private:
 
+  // Number of parts of the input range between checks in bounded evaluation
+  static constexpr unsigned nChunks = 8;
+
+  static std::vector<Channel>& channelTable() {
+    static std::vector<Channel> tab{};
+    return tab;
+  }
+
+  /* Hutchinson estimate of the error: for psi with independent random
+   * phases, the mean of <F psi|U psi> is Tr(F^† U) / dim. The standard
+   * deviation of a single term is below 1/sqrt(dim), so a few probes
+   * suffice for larger circuits. */
+  double estimateError() const {
+    using cxd = std::complex<double>;
+    unsigned dim = 1 << Config::nBit;
+    double norm = 1 / std::sqrt(dim);
+    std::uniform_real_distribution<> dPhase{0, 2 * QGA::Const::pi};
+    cxd overlapTotal{0};
+    State psi{};
+    for(unsigned k = 0; k < Config::estProbes; k++) {
+      for(unsigned i = 0; i < dim; i++)
+        psi[i] = std::polar(norm, dPhase(gen::rng));
+      overlapTotal += State::overlap(State::fourier(psi), sim(psi));
+    }
+    return std::max(1.0 - std::abs(overlapTotal / cxd(Config::estProbes)),
+        0.0);
+  }
+
   State sim(const State& psi) const {
     State ret{psi};
-    for(const auto& g : genotype())
-      ret = g->applyTo(ret);
+    simulate(ret);
     return ret;
   }
 
@@ -29,6 +29,10 @@ public:
 
   OracleTemp(bool odd_ = true): odd(odd_) { }
 
+  static Pointer random() {
+    return make(true);
+  }
+
   State applyTo(const State& psi, const Context* pMark) const override {
     unsigned mark = pMark->mark;
     State ret{psi};
@@ -60,7 +64,7 @@ public:
   }
 
   Pointer getAnother() const override {
-    return std::make_shared<OracleTemp>();
+    return make(true);
   }
 
   Pointer merge(const GateBase& other) const override {
@@ -68,7 +72,7 @@ public:
       return {};
     // oracle * oracle = oracle^2 → true ^ true = false
     const OracleTemp* c = other.cast(this);
-    return std::make_shared<OracleTemp>(odd ^ c->odd);
+    return make(odd ^ c->odd);
   }
 
   std::ostream& write(std::ostream& os) const override {
@@ -80,12 +84,30 @@ public:
       p.addBarrierGate("U_f");
   }
 
+  bool encode(QGA::internal::GeneCode& code) const override {
+    code.op = odd;
+    return true;
+  }
+
   static Pointer read(const std::string& s) {
-    regex::regex re{"\\[Id\\]|(Oracle)"};
-    regex::matches ms{};
-    if(!re.match(s, ms))
+    if(s == "Oracle" || s == "[Id]")
+      return make(s[0] == 'O');
+    return {};
+  }
+
+  static Pointer decode(const QGA::internal::GeneCode& code) {
+    if(code.op > 1 || !code.fits(0) || code.tgt || code.ctrl)
       return {};
-    return std::make_shared<OracleTemp>(ms.matched(1));
+    return make(code.op);
+  }
+
+private:
+
+  // There are just two distinct oracles, see Interned
+  static Pointer make(bool odd) {
+    return QGA::Interned<OracleTemp, Pointer>::get(odd, 2, [=]() -> Pointer {
+        return std::make_shared<OracleTemp>(odd);
+      });
   }
 
 }; // class Oracle::OracleTemp<GateBase>
@@ -96,52 +118,127 @@ using Template = OracleTemp<GateBase>;
 }; // struct Oracle
 
 
+#ifdef MODULES
+  #error Modules can't be used with a Context (the oracle's mark).
+#endif
+
+// Grover-like circuits act on all qubits alike
 using Gene = typename QGA::Gene<
                 Oracle,
-                QGA::Gates::X,
-                QGA::Gates::CPhase
+                QGA::Gates::X::WithLift<QGA::Lift::COPY>,
+                QGA::Gates::CPhase::WithLift<QGA::Lift::EXTEND>
               >::WithContext<Context>;
 
 
-class Candidate : public QGA::CandidateBase<Candidate, Gene, double, unsigned, unsigned> {
+class Candidate : public QGA::CandidateBase<Candidate, Gene, double, unsigned, unsigned, double> {
 
-  using Base = QGA::CandidateBase<Candidate, Gene, double, unsigned, unsigned>;
+  using Base = QGA::CandidateBase<Candidate, Gene, double, unsigned, unsigned, double>;
 
 public:
 
   using Base::Base;
 
+  // Identifies the problem in persistent caches
+  static const char* name() {
+    return "search";
+  }
+
   Base::Fitness fitness() const {
-    if(genotype().size() > 1000)
+    if(overBudget(1 << Config::nBit))
       return {};
-    double errMax = 0;
-    unsigned dim = 1 << Config::nBit;
-    State psi{0};
-    for(unsigned mark = 0; mark < dim; mark++) {
-      State out{mark};
-      double error = std::max(1 -
-          std::pow(std::abs(State::overlap(out, sim(psi, mark))), 2), 0.0);
-      if(error > errMax)
-        errMax = error;
-    }
     unsigned oracles = 0;
     for(const auto& g : genotype())
       if(g->type() == Gene::gateType<Oracle>())
         oracles++;
+    double errMax = memoError([&]() -> double {
+        double errMax = 0;
+        unsigned dim = 1 << Config::nBit;
+        size_t pos = prefixLength();
+        // A parent's checkpoint past the first Oracle saves more
+        bool fromParent = resumePos() > pos;
+        State pre{};
+        if(!fromParent)
+          pre = simChannel(0, pos);
+        // The maximum over a subset of marks bounds the final error
+        unsigned chunk = std::max(dim / nChunks, 1u);
+        for(unsigned first = 0; first < dim; first += chunk) {
+          if(tryReject({trimError(errMax), genotype().size(), oracles, 0.0}))
+            break;
+          std::vector<State> outs{};
+          if(fromParent)
+            for(unsigned i = 0; i < chunk; i++)
+              outs.push_back(simChannel(first + i));
+          else
+            outs = simMarks(pre, pos, first, chunk);
+          for(unsigned i = 0; i < chunk; i++) {
+            // overlap with the basis state |mark>
+            double error = std::max(1 - std::norm(outs[i][first + i]), 0.0);
+            if(error > errMax)
+              errMax = error;
+          }
+        }
+        return errMax;
+      });
+    if(rejected())
+      return {};
     return {
       trimError(errMax),
       genotype().size(),
-      oracles
+      oracles,
+      trimError(noisyError())
     };
   }
 
+  // One context per mark for the gradient channels
+  static void precompute() {
+    Base::precompute();
+    unsigned dim = 1 << Config::nBit;
+    std::vector<Context>& ctxs = contexts();
+    std::vector<Channel>& chs = channelTable();
+    ctxs.clear();
+    chs.clear();
+    ctxs.reserve(dim);
+    chs.reserve(dim);
+    for(unsigned mark = 0; mark < dim; mark++) {
+      ctxs.push_back({mark});
+      chs.push_back({State{0}, State{mark}, &ctxs.back()});
+    }
+  }
+
+  // Search for each of the marks, see CandidateBase::optimize()
+  static const std::vector<Channel>& channels() {
+    return channelTable();
+  }
+
+  // The marks range over all basis states, so all qubits are alike
+  static std::vector<unsigned> qubitClasses() {
+    return std::vector<unsigned>(Config::nBit, 0);
+  }
+
+  /* The maximum over marks in fitness() is not smooth, so the mean error is
+   * used for optimization instead. */
+  static double surrogate(const std::vector<QGA::Backend::cxd>& a,
+      std::vector<QGA::Backend::cxd>& w) {
+    double n = a.size(), total = 0;
+    w.resize(a.size());
+    for(size_t i = 0; i < a.size(); i++) {
+      total += 1 - std::norm(a[i]);
+      w[i] = -2.0 * std::conj(a[i]) / n;
+    }
+    return total / n;
+  }
+
+  State probe(const QGA::Fingerprint::Probe& p) const {
+    return sim(p.psi, p.aux);
+  }
+
   std::ostream& print_full(std::ostream& os) const {
     unsigned dim = 1 << Config::nBit;
-    State psi{0};
+    std::vector<State> outs = simAll(State{0});
     os << '\n';
     for(unsigned mark = 0; mark < dim; mark++) {
       os << mark << ": ";
-      os << sim(psi, mark);
+      os << outs[mark];
     }
     return os;
   }
@@ -151,11 +248,56 @@ private:
   State sim(const State& psi, unsigned mark) const {
     State ret{psi};
     Context c{mark};
-    for(const auto& g : genotype())
-      ret = g->applyTo(ret, &c);
+    simulate(ret, &c);
     return ret;
   }
 
+  static std::vector<Context>& contexts() {
+    static std::vector<Context> ctxs{};
+    return ctxs;
+  }
+
+  static std::vector<Channel>& channelTable() {
+    static std::vector<Channel> chs{};
+    return chs;
+  }
+
+  // Number of parts of the mark range between checks in bounded evaluation
+  static constexpr unsigned nChunks = 8;
+
+  /* Equivalent to sim(psi, mark) for all marks at once. Everything up to the
+   * first Oracle is independent of the mark so it's only simulated once and
+   * the state is forked there. */
+  std::vector<State> simAll(const State& psi) const {
+    size_t pos = prefixLength();
+    State pre{psi};
+    simulate(pre, 0, pos);
+    return simMarks(pre, pos, 0, 1 << Config::nBit);
+  }
+
+  // Number of gates before the first Oracle
+  size_t prefixLength() const {
+    size_t pos = 0;
+    for(const auto& g : genotype()) {
+      if(g->type() == Gene::gateType<Oracle>())
+        break;
+      pos++;
+    }
+    return pos;
+  }
+
+  /* Forks pre, the state after the first pos gates, for marks first to
+   * first + count - 1 and applies the rest of the circuit to each. */
+  std::vector<State> simMarks(const State& pre, size_t pos,
+      unsigned first, unsigned count) const {
+    std::vector<State> rets(count, pre);
+    for(unsigned i = 0; i < count; i++) {
+      Context c{first + i};
+      simulate(rets[i], pos, genotype().size(), &c);
+    }
+    return rets;
+  }
+
 }; // class Candidate
 
 } // anonymous namespace
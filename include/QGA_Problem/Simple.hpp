@@ -13,13 +13,18 @@ static const std::vector<QGA::Gates::gate_struct_f> reduced_set {
   { &QGA::Backend::Ti, "Ti", -1, 0 },
 };
 
+#ifdef MODULES
+  #error The simple problem has no Module gene.
+#endif
+
 using Gene = QGA::Gene<
                QGA::Gates::Fixed
                  ::WithControls<QGA::Controls::ANY>
                  ::WithGates<&reduced_set>
              >;
 
-const State out{3};
+// Index of the target basis state
+const unsigned target = 3;
 
 
 class Candidate : public QGA::CandidateBase<Candidate, Gene, double, unsigned, unsigned>
@@ -31,24 +36,68 @@ public:
 
   using Base::Base;
 
+  // Identifies the problem in persistent caches
+  static const char* name() {
+    return "simple";
+  }
+
   Base::Fitness fitness() const {
     return {
-      trimError(1 - std::abs(State::overlap(out, sim()))), // error
+      trimError(1 - std::abs(simChannel(0)[target])), // error
       genotype().size(), // total gate count
       controls() // total number of control qubits
     };
   }
 
+  // See CandidateBase::sameFunc()
+  State probe(const QGA::Fingerprint::Probe& p) const {
+    State psi{p.psi};
+    simulate(psi);
+    return psi;
+  }
+
   std::ostream& print_full(std::ostream& os) const {
     return os << sim();
   }
 
+  // The states depend on Config::nBit, so they are rebuilt with it
+  static void precompute() {
+    Base::precompute();
+    std::vector<Channel>& chs = channelTable();
+    chs.clear();
+    chs.push_back({State{0}, State{target}, nullptr});
+  }
+
+  // See CandidateBase::optimize()
+  static const std::vector<Channel>& channels() {
+    return channelTable();
+  }
+
+  // Qubits which are equal in the target state can be exchanged
+  static std::vector<unsigned> qubitClasses() {
+    std::vector<unsigned> ret(Config::nBit);
+    for(unsigned q = 0; q < Config::nBit; q++)
+      ret[q] = (target >> (Config::nBit - 1 - q)) & 1;
+    return ret;
+  }
+
+  static double surrogate(const std::vector<QGA::Backend::cxd>& a,
+      std::vector<QGA::Backend::cxd>& w) {
+    double abs = std::abs(a[0]);
+    w.assign(1, abs > 0 ? -std::conj(a[0]) / abs : -1);
+    return 1 - abs;
+  }
+
 private:
 
+  static std::vector<Channel>& channelTable() {
+    static std::vector<Channel> chs{};
+    return chs;
+  }
+
   State sim() const {
     State psi{0};
-    for(const auto& g : genotype())
-      psi = g->applyTo(psi);
+    simulate(psi);
     return psi;
   }
 
@@ -0,0 +1,197 @@
+// allow only one problem
+#ifndef QGA_PROBLEM_HPP
+#define QGA_PROBLEM_HPP
+
+namespace {
+
+using QGA::Backend::State;
+
+/* Maps a given set of input states to a given set of target states, e.g., for
+ * encoding circuits or isometries. The pairs are read from the binary file
+ * given by Config::dataFile:
+ *
+ *   char magic[8];          "QGAPAIRS"
+ *   uint32_t nBit;          must equal Config::nBit
+ *   uint32_t count;         number of pairs
+ *   followed by count times:
+ *     complex<double> input[1 << nBit];
+ *     complex<double> target[1 << nBit];
+ *
+ * in native byte order. The error of each pair is 1 - |<target|U|input>|^2,
+ * so each output is only compared up to a phase. The fitness uses the
+ * maximum or, if Config::meanError is set, the mean over all pairs. */
+
+using Gene = QGA::Gene<
+               QGA::Gates::SU2,
+               QGA::Gates::CNOT
+#ifdef MODULES
+               , QGA::Gates::Module
+#endif
+             >;
+
+
+class Candidate : public QGA::CandidateBase<Candidate, Gene, double, size_t, unsigned> {
+
+  using Base = QGA::CandidateBase<Candidate, Gene, double, size_t, unsigned>;
+
+public:
+
+  using Base::Base;
+
+  /* Identifies the problem in persistent caches. Includes a hash of the
+   * data file so that different sets of pairs are kept apart, and whether
+   * the error is the mean or the maximum. */
+  static const char* name() {
+    return nameString().c_str();
+  }
+
+  // Reads the pairs from Config::dataFile
+  static void precompute() {
+    Base::precompute();
+    if(Config::dataFile.empty())
+      throw std::runtime_error("No data file given (use --data FILE)");
+    MappedFile file{Config::dataFile, false};
+    const char* data = static_cast<const char*>(file.data());
+    const size_t headSize = 16;
+    std::uint32_t nBit, count;
+    if(file.size() < headSize || std::string(data, 8) != "QGAPAIRS")
+      throw std::runtime_error(Config::dataFile + ": not a pairs file");
+    std::memcpy(&nBit, data + 8, sizeof nBit);
+    std::memcpy(&count, data + 12, sizeof count);
+    if(nBit != Config::nBit)
+      throw std::runtime_error(Config::dataFile + ": pairs are for "
+          + std::to_string(nBit) + " qubits");
+    size_t dim = size_t(1) << nBit;
+    size_t vecSize = dim * sizeof(QGA::Backend::cxd);
+    if(count == 0 || file.size() != headSize + 2 * count * vecSize)
+      throw std::runtime_error(Config::dataFile + ": wrong size");
+    std::vector<Channel>& chs = channelTable();
+    chs.clear();
+    chs.reserve(count);
+    const char* p = data + headSize;
+    for(size_t i = 0; i < count; i++) {
+      State in = readState(p, dim);
+      State out = readState(p + vecSize, dim);
+      p += 2 * vecSize;
+      if(std::abs(State::overlap(in, in) - 1.0) > 1e-6
+          || std::abs(State::overlap(out, out) - 1.0) > 1e-6)
+        throw std::runtime_error(Config::dataFile + ": pair "
+            + std::to_string(i) + " is not normalized");
+      chs.push_back({std::move(in), std::move(out), nullptr});
+    }
+    std::ostringstream os{};
+    os << (Config::meanError ? "stateprep-mean:" : "stateprep:")
+      << std::hex << std::setw(8) << std::setfill('0')
+      << std::uint32_t(QGA::internal::fnv1a(data, file.size()));
+    nameString() = os.str();
+  }
+
+  // The pairs, see CandidateBase::optimize()
+  static const std::vector<Channel>& channels() {
+    return channelTable();
+  }
+
+  /* The maximum over pairs in fitness() is not smooth, so the mean error is
+   * used for optimization in either case. */
+  static double surrogate(const std::vector<QGA::Backend::cxd>& a,
+      std::vector<QGA::Backend::cxd>& w) {
+    double n = a.size(), total = 0;
+    w.resize(a.size());
+    for(size_t i = 0; i < a.size(); i++) {
+      total += 1 - std::norm(a[i]);
+      w[i] = -2.0 * std::conj(a[i]) / n;
+    }
+    return total / n;
+  }
+
+  Base::Fitness fitness() const {
+    if(overBudget(channels().size()))
+      return {};
+    double error = memoError([&]() -> double {
+        const std::vector<Channel>& chs = channels();
+        size_t count = chs.size();
+        double errMax = 0, errTotal = 0;
+        unsigned ctrls = controls();
+        // Both the maximum and the mean over a subset bound the final error
+        size_t chunk = std::max(count / nChunks, size_t(1));
+        for(size_t first = 0; first < count; first += chunk) {
+          double bound = Config::meanError ? errTotal / count : errMax;
+          if(tryReject({trimError(bound), genotype().size(), ctrls}))
+            break;
+          size_t cnt = std::min(chunk, count - first);
+          std::vector<State> outs = simPairs(first, cnt);
+          for(size_t i = 0; i < cnt; i++) {
+            double error = std::max(1 - std::norm(
+                  State::overlap(chs[first + i].target, outs[i])), 0.0);
+            errTotal += error;
+            if(error > errMax)
+              errMax = error;
+          }
+        }
+        return Config::meanError ? errTotal / count : errMax;
+      });
+    if(rejected())
+      return {};
+    return {
+      trimError(error),
+      genotype().size(),
+      controls()
+    };
+  }
+
+  State probe(const QGA::Fingerprint::Probe& p) const {
+    State psi{p.psi};
+    simulate(psi);
+    return psi;
+  }
+
+  std::ostream& print_full(std::ostream& os) const {
+    const std::vector<Channel>& chs = channels();
+    std::vector<State> outs = simPairs(0, chs.size());
+    os << '\n';
+    for(size_t i = 0; i < chs.size(); i++)
+      os << i << ": " << std::abs(State::overlap(chs[i].target, outs[i]))
+        << ' ' << outs[i];
+    return os;
+  }
+
+private:
+
+  // Number of parts of the pair range between checks in bounded evaluation
+  static constexpr size_t nChunks = 8;
+
+  static std::vector<Channel>& channelTable() {
+    static std::vector<Channel> chs{};
+    return chs;
+  }
+
+  static std::string& nameString() {
+    static std::string name{"stateprep"};
+    return name;
+  }
+
+  static State readState(const char* p, size_t dim) {
+    State ret{0};
+    QGA::Backend::cxd z;
+    for(size_t j = 0; j < dim; j++) {
+      std::memcpy(&z, p + j * sizeof z, sizeof z);
+      ret[j] = z;
+    }
+    return ret;
+  }
+
+  /* Outputs for the pairs first to first + count - 1. A checkpoint from a
+   * brood parent is used if present. */
+  std::vector<State> simPairs(size_t first, size_t count) const {
+    std::vector<State> rets{};
+    rets.reserve(count);
+    for(size_t i = 0; i < count; i++)
+      rets.push_back(simChannel(first + i));
+    return rets;
+  }
+
+}; // class Candidate
+
+} // anonymous namespace
+
+#endif // !defined QGA_PROBLEM_HPP
@@ -0,0 +1,199 @@
+// allow only one problem
+#ifndef QGA_PROBLEM_HPP
+#define QGA_PROBLEM_HPP
+
+namespace {
+
+using QGA::Backend::State;
+using QGA::Backend::cxd;
+
+/* Compiles a general unitary given in the binary file Config::dataFile:
+ *
+ *   char magic[8];          "QGAUNITR"
+ *   uint32_t nBit;          must equal Config::nBit
+ *   uint32_t reserved;      0
+ *   complex<double> matrix[1 << nBit][1 << nBit];
+ *
+ * in native byte order, stored by columns (the image of each basis state in
+ * turn). The error is 1 - |Tr(T^† U)| / 2^n, which ignores a global phase.
+ *
+ * The file is mapped read-only and the columns of the target are read
+ * directly from the mapping, so several concurrent runs share one copy in
+ * memory. The gradient optimizer, brood mode and noise get the columns one
+ * at a time as States, see channel(). */
+
+using Gene = QGA::Gene<
+               QGA::Gates::SU2,
+               QGA::Gates::CNOT
+#ifdef MODULES
+               , QGA::Gates::Module
+#endif
+             >;
+
+
+class Candidate : public QGA::CandidateBase<Candidate, Gene, double, size_t, unsigned> {
+
+  using Base = QGA::CandidateBase<Candidate, Gene, double, size_t, unsigned>;
+
+public:
+
+  using Base::Base;
+
+  /* Identifies the problem in persistent caches. Includes a hash of the
+   * data file so that different targets are kept apart. */
+  static const char* name() {
+    return nameString().c_str();
+  }
+
+  // Maps Config::dataFile and checks its header
+  static void precompute() {
+    Base::precompute();
+    if(Config::dataFile.empty())
+      throw std::runtime_error("No data file given (use --data FILE)");
+    MappedFile& file = mapping();
+    file = MappedFile{Config::dataFile, false};
+    const char* data = static_cast<const char*>(file.data());
+    std::uint32_t nBit;
+    if(file.size() < headSize || std::string(data, 8) != "QGAUNITR")
+      throw std::runtime_error(Config::dataFile + ": not a unitary file");
+    std::memcpy(&nBit, data + 8, sizeof nBit);
+    if(nBit != Config::nBit)
+      throw std::runtime_error(Config::dataFile + ": unitary is for "
+          + std::to_string(nBit) + " qubits");
+    size_t dim = size_t(1) << nBit;
+    if(file.size() != headSize + dim * dim * sizeof(cxd))
+      throw std::runtime_error(Config::dataFile + ": wrong size");
+    std::ostringstream os{};
+    os << "unitary:" << std::hex << std::setw(8) << std::setfill('0')
+      << std::uint32_t(QGA::internal::fnv1a(data, file.size()));
+    nameString() = os.str();
+  }
+
+  // One channel per basis state, see CandidateBase::channel()
+  static size_t channelCount() {
+    return size_t(1) << Config::nBit;
+  }
+
+  /* Basis state i and column i of the target, built from the mapping on
+   * each call so that the matrix is never copied as a whole. */
+  static Channel channel(size_t i) {
+    size_t dim = size_t(1) << Config::nBit;
+    State out{0};
+    const cxd* col = column(i);
+    for(size_t j = 0; j < dim; j++)
+      out[j] = col[j];
+    return {State{i}, std::move(out), nullptr};
+  }
+
+  // The error computed in fitness() and its differential
+  static double surrogate(const std::vector<cxd>& a, std::vector<cxd>& w) {
+    cxd total{0};
+    for(auto& z : a)
+      total += z;
+    double dim = a.size(), abs = std::abs(total);
+    w.assign(a.size(), abs > 0 ? -std::conj(total) / (abs * dim) : -1 / dim);
+    return 1 - abs / dim;
+  }
+
+  Base::Fitness fitness() const {
+    if(overBudget(size_t(1) << Config::nBit))
+      return {};
+    double error = memoError([&]() -> double {
+        size_t dim = size_t(1) << Config::nBit;
+        size_t chunk = std::max(dim / nChunks, size_t(1));
+        unsigned ctrls = controls();
+        cxd trace{0};
+        for(size_t first = 0; first < dim; first += chunk) {
+          // Each of the remaining overlaps has an absolute value <= 1
+          double bound = 1.0 - (std::abs(trace) + (dim - first)) / dim;
+          if(tryReject({trimError(std::max(bound, 0.0)), genotype().size(),
+                ctrls}))
+            break;
+          size_t cnt = std::min(chunk, dim - first);
+          std::vector<State> outs = simColumns(first, cnt);
+          for(size_t i = 0; i < cnt; i++) {
+            const cxd* col = column(first + i);
+            for(size_t j = 0; j < dim; j++)
+              trace += std::conj(col[j]) * outs[i][j];
+          }
+        }
+        return std::max(1.0 - std::abs(trace) / dim, 0.0);
+      });
+    if(rejected())
+      return {};
+    return {
+      trimError(error),
+      genotype().size(),
+      controls()
+    };
+  }
+
+  State probe(const QGA::Fingerprint::Probe& p) const {
+    State psi{p.psi};
+    simulate(psi);
+    return psi;
+  }
+
+  std::ostream& print_full(std::ostream& os) const {
+    size_t dim = size_t(1) << Config::nBit;
+    std::vector<State> outs = simColumns(0, dim);
+    os << '\n';
+    for(size_t i = 0; i < dim; i++) {
+      const cxd* col = column(i);
+      cxd overlap{0};
+      for(size_t j = 0; j < dim; j++)
+        overlap += std::conj(col[j]) * outs[i][j];
+      os << i << ": " << std::abs(overlap) << "∠" << std::showpos
+        << std::arg(overlap) / QGA::Const::pi << "π" << std::noshowpos
+        << '\n';
+    }
+    return os;
+  }
+
+private:
+
+  static constexpr size_t headSize = 16;
+
+  // Number of parts of the input range between checks in bounded evaluation
+  static constexpr unsigned nChunks = 8;
+
+  static MappedFile& mapping() {
+    static MappedFile file{};
+    return file;
+  }
+
+  static std::string& nameString() {
+    static std::string name{"unitary"};
+    return name;
+  }
+
+  // Column i of the target, pointing into the mapping
+  static const cxd* column(size_t i) {
+    const char* data = static_cast<const char*>(mapping().data());
+    return reinterpret_cast<const cxd*>(data + headSize)
+      + (i << Config::nBit);
+  }
+
+  /* Images of the basis states first to first + count - 1. A checkpoint
+   * from a brood parent is used if present, otherwise no channel() is
+   * needed. */
+  std::vector<State> simColumns(size_t first, size_t count) const {
+    std::vector<State> rets{};
+    rets.reserve(count);
+    if(resumePos() > 0) {
+      for(size_t i = 0; i < count; i++)
+        rets.push_back(simChannel(first + i));
+      return rets;
+    }
+    for(size_t i = 0; i < count; i++)
+      rets.push_back(State{first + i});
+    for(auto& psi : rets)
+      simulate(psi);
+    return rets;
+  }
+
+}; // class Candidate
+
+} // anonymous namespace
+
+#endif // !defined QGA_PROBLEM_HPP
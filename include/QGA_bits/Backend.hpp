@@ -5,27 +5,33 @@ namespace Backend {
 using cxd = std::complex<double>;
 
 
-class Gate {
+/* A 2×2 matrix, held inline in row-major order. It is trivially copyable,
+ * so gates can store, copy and multiply their matrices without allocating.
+ * The backends convert it to their own matrix types when applying it. */
 
-  class GateImpl;
-  std::unique_ptr<GateImpl> pImpl;
+class Gate {
 
 public:
 
-  Gate(const Gate&);
-  Gate(GateImpl&&);
-  Gate(cxd u11, cxd u12, cxd u21, cxd u22);
-  ~Gate();
+  constexpr Gate(cxd u11, cxd u12, cxd u21, cxd u22):
+    m{u11, u12, u21, u22} { }
 
-  friend Gate operator*(const Gate& lhs, const Gate& rhs);
+  friend Gate operator*(const Gate& lhs, const Gate& rhs) {
+    return {
+      lhs.m[0] * rhs.m[0] + lhs.m[1] * rhs.m[2],
+      lhs.m[0] * rhs.m[1] + lhs.m[1] * rhs.m[3],
+      lhs.m[2] * rhs.m[0] + lhs.m[3] * rhs.m[2],
+      lhs.m[2] * rhs.m[1] + lhs.m[3] * rhs.m[3]
+    };
+  }
 
-  cxd operator() (size_t rx, size_t cx);
+  constexpr cxd operator() (size_t rx, size_t cx) const {
+    return m[2 * rx + cx];
+  }
 
 private:
 
-  const GateImpl& impl() const;
-
-  friend class State;
+  cxd m[4];
 
 }; // class Gate
 
@@ -40,36 +46,62 @@ extern const Gate S;
 extern const Gate Si;
 
 
-class Controls {
+/* A set of control qubits, held as a bit mask with qubit q as bit q (so at
+ * most 64 qubits). It is stored inline, and copying, comparing and swapping
+ * qubits don't allocate. The backends build their lists of indices from
+ * as_vector() when applying a gate. */
 
-  class ControlsImpl;
-  std::unique_ptr<ControlsImpl> pImpl;
+class Controls {
 
 public:
 
-  Controls();
-  Controls(const Controls&);
-  Controls(ControlsImpl&&);
-  Controls(const std::vector<bool>& bits);
-  ~Controls();
+  Controls(): bits(0) { }
 
-  Controls& operator=(const Controls&);
-  Controls& operator=(Controls&&);
+  explicit Controls(std::uint64_t mask_): bits(mask_) { }
 
-  friend bool operator==(const Controls& lhs, const Controls& rhs);
+  Controls(const std::vector<bool>& flags): bits(0) {
+    for(unsigned q = 0; q < flags.size(); q++)
+      if(flags[q])
+        bits |= bit(q);
+  }
 
-  size_t size() const;
+  friend bool operator==(const Controls& lhs, const Controls& rhs) {
+    return lhs.bits == rhs.bits;
+  }
 
-  static Controls swapGate(unsigned s1, unsigned s2);
-  static Controls swapQubits(const Controls& orig, unsigned s1, unsigned s2);
+  size_t size() const {
+    return std::bitset<64>(bits).count();
+  }
 
-  std::vector<unsigned> as_vector() const;
+  bool contains(unsigned q) const {
+    return bits & bit(q);
+  }
+
+  std::uint64_t mask() const {
+    return bits;
+  }
+
+  static Controls swapQubits(const Controls& orig, unsigned s1, unsigned s2) {
+    if(orig.contains(s1) == orig.contains(s2))
+      return orig;
+    return Controls{orig.bits ^ bit(s1) ^ bit(s2)};
+  }
+
+  std::vector<unsigned> as_vector() const {
+    std::vector<unsigned> ret{};
+    for(unsigned q = 0; q < 64; q++)
+      if(contains(q))
+        ret.push_back(q);
+    return ret;
+  }
 
 private:
 
-  const ControlsImpl& impl() const;
+  static std::uint64_t bit(unsigned q) {
+    return std::uint64_t(1) << q;
+  }
 
-  friend class State;
+  std::uint64_t bits;
 
 }; // class Controls
 
@@ -93,7 +125,14 @@ public:
   void reset(size_t index);
 
   State apply_ctrl(const Gate& mat, const Controls& ixs, unsigned tgt) const;
-  State swapQubits(const Controls& ixs) const;
+  State apply_block(const std::vector<cxd>& mat,
+      const std::vector<unsigned>& qubits) const;
+  State swapQubits(unsigned s1, unsigned s2) const;
+
+  /* In-place versions of apply_ctrl() and swapQubits() taking the qubits as
+   * bit masks of the basis state index. */
+  void apply_ctrl_mask(const cxd (&mat)[4], size_t ctrls, size_t tgt);
+  void swap_mask(size_t m1, size_t m2);
 
   static State fourier(const State& in);
   static cxd overlap(const State& lhs, const State& rhs);
@@ -101,6 +140,7 @@ public:
   friend std::ostream& operator<< (std::ostream& os, const State& state);
 
   cxd& operator[](size_t);
+  cxd operator[](size_t) const;
 
 private:
 
@@ -17,19 +17,42 @@ public:
 
   using GeneType = Gene;
 
-  CandidateBase(std::vector<Gene>&& gt_):
-      gt(std::move(gt_)) {
-    if(gt.size() == 0)
+  /* The genes of a candidate. Children share the unchanged parts of their
+   * parents' genotypes, see internal::Rope. */
+  using Genotype = internal::Rope<Gene>;
+
+  /* One term of the differentiable error measure used by optimize(): the
+   * overlap of target with the output of the circuit for input psi when
+   * run with the given context. */
+  struct Channel {
+    Backend::State psi;
+    Backend::State target;
+    const typename Gene::ContextType* ctx;
+  };
+
+  /* Takes the genes from gt_ and brings them to the canonical form, see
+   * relabelling() and canonical(). gt_ is used as a work area and left
+   * empty but with its capacity, so a caller can reuse one buffer for many
+   * candidates. */
+  CandidateBase(std::vector<Gene>&& gt_): gt() {
+    if(!keepLabels())
+      relabel(gt_, relabelling(gt_.begin(), gt_.end()));
+    gt = canonical(gt_);
+  }
+
+  /* Takes a genotype assembled by Genotype::Builder. It is only copied if
+   * the canonical form differs, which children of canonical parents often
+   * avoid. */
+  CandidateBase(Genotype&& gt_): gt() {
+    Swaps swaps = keepLabels() ? Swaps{}
+      : relabelling(gt_.begin(), gt_.end());
+    if(swaps.empty() && isCanonical(gt_)) {
+      gt = std::move(gt_);
       return;
-    auto end = gt.end(), last = gt.begin();
-    for(auto cur = last + 1; cur != end; cur++) {
-      // Can be merged: done, go to next cur
-      // Can not: put *cur after *last and increase both
-      bool consumed = (*last).merge(*cur);
-      if(!consumed)
-        std::swap(*++last, *cur);
     }
-    gt.erase(++last, gt.end());
+    std::vector<Gene> work(gt_.begin(), gt_.end());
+    relabel(work, swaps);
+    gt = canonical(work);
   }
 
   friend bool sameCirc(const CandidateBase& lhs, const CandidateBase& rhs) {
@@ -37,10 +60,19 @@ public:
     auto& gt2 = rhs.gt;
     if(gt1.size() != gt2.size())
       return false;
-    for(size_t i = 0; i < gt1.size(); i++)
-      if(!sameType(gt1[i], gt2[i]))
-        return false;
-    return true;
+    return std::equal(gt1.begin(), gt1.end(), gt2.begin(),
+        [](const Gene& g1, const Gene& g2) { return sameType(g1, g2); });
+  }
+
+  /* Whether two candidates implement the same function up to a global
+   * phase, as far as the problem's channels (see channel()) can tell. The
+   * fingerprints (see Fingerprint.hpp) are compared first, computing them
+   * on first use, and a match is confirmed by simulating all the channels
+   * of both circuits, so this is only worth calling for candidates which
+   * are likely equivalent, e.g., have equal errors. Must not be called
+   * during a parallel evaluation. */
+  friend bool sameFunc(const CandidateBase& lhs, const CandidateBase& rhs) {
+    return lhs.fingerprint() == rhs.fingerprint() && sameOutputs(lhs, rhs);
   }
 
   friend std::ostream& operator<< (std::ostream& os, const CandidateBase& c) {
@@ -70,10 +102,235 @@ public:
     return {std::move(gt)};
   }
 
-  const std::vector<Gene>& genotype() const {
+  /* Reads candidates from a file in either form described in
+   * GenotypeFile.hpp. Throws std::runtime_error if the file can't be read
+   * or any gene is invalid. */
+  static std::vector<Derived> load(const std::string& file) {
+    MappedFile mf{file, false};
+    const char* data = static_cast<const char*>(mf.data());
+    std::vector<Derived> ret{};
+    std::vector<Gene> gt{};
+    if(internal::GenotypeReader<Gene>::detect(data, mf.size())) {
+      internal::GenotypeReader<Gene> rd{data, mf.size(), file};
+      while(rd.read(gt))
+        ret.push_back({std::move(gt)});
+    } else {
+      internal::GenotypeTextReader<Gene> rd{data, mf.size(), file};
+      while(rd.read(gt))
+        ret.push_back({std::move(gt)});
+    }
+    return ret;
+  }
+
+  /* Writes the candidates to a file in the binary form, skipping those
+   * which contain genes without one (see GateBase::encode()). Returns the
+   * number of candidates written. */
+  template<class Container>
+  static size_t save(const std::string& file, const Container& cands) {
+    std::ofstream os{file, std::ios::binary | std::ios::trunc};
+    internal::GenotypeWriter<Gene> wr{os};
+    size_t count = 0;
+    for(const CandidateBase& c : cands)
+      count += wr.write(c.gt);
+    if(!(os << std::flush))
+      throw std::runtime_error("Can't write " + file);
+    return count;
+  }
+
+  const Genotype& genotype() const {
     return gt;
   }
 
+  /* Brood mode: while an instance exists, candidates made by the current
+   * thread are not relabelled (see relabelling()), so that a child keeps
+   * the qubit labels of its parent and shares as much of its circuit as
+   * possible. shareCheckpoints() relabels the children afterwards. */
+  class KeepLabels {
+
+  public:
+
+    KeepLabels() {
+      keepLabels() = true;
+    }
+
+    ~KeepLabels() {
+      keepLabels() = false;
+    }
+
+  }; // class KeepLabels
+
+  /* Brood mode: lets each child of parent continue the parent's simulation
+   * of the channels (see channel()) from the point where their genotypes
+   * start to differ instead of from scratch. The parent is only simulated
+   * once, stopping at each of these points. Children made under KeepLabels
+   * are relabelled here unless that would shorten the part they share with
+   * the parent: such a child then escapes the qubit symmetry but resumes
+   * from further down the circuit. */
+  static void shareCheckpoints(const CandidateBase& parent,
+      std::vector<Derived>& brood) {
+    size_t nc = Derived::channelCount();
+    std::vector<size_t> pos{};
+    for(CandidateBase& c : brood) {
+      size_t p = commonPrefix(c.gt, parent.gt);
+      Swaps swaps = relabelling(c.gt.begin(), c.gt.end());
+      if(!swaps.empty()) {
+        std::vector<Gene> work(c.gt.begin(), c.gt.end());
+        relabel(work, swaps);
+        Genotype gtNew = canonical(work);
+        size_t q = commonPrefix(gtNew, parent.gt);
+        if(q >= p) {
+          c.gt = std::move(gtNew);
+          p = q;
+        }
+      }
+      pos.push_back(p);
+    }
+    std::vector<size_t> stops{pos};
+    std::sort(stops.begin(), stops.end());
+    stops.erase(std::unique(stops.begin(), stops.end()), stops.end());
+    std::vector<Backend::State> cur{};
+    for(size_t ic = 0; ic < nc; ic++)
+      cur.push_back(Derived::channel(ic).psi);
+    std::vector<std::shared_ptr<const Checkpoint>> cps{};
+    const internal::PackedCircuit<Gene>& pc = parent.packed();
+    size_t at = 0;
+    for(size_t p : stops) {
+      for(size_t ic = 0; ic < nc; ic++)
+        pc.apply(cur[ic], at, p, Derived::channel(ic).ctx);
+      at = p;
+      cps.push_back(std::make_shared<Checkpoint>(Checkpoint{p, cur}));
+    }
+    for(size_t i = 0; i < brood.size(); i++)
+      if(pos[i] > 0)
+        brood[i].resume = cps[std::lower_bound(stops.begin(), stops.end(),
+            pos[i]) - stops.begin()];
+  }
+
+  // Releases the checkpoint from shareCheckpoints() after evaluation
+  void dropCheckpoint() const {
+    resume.reset();
+  }
+
+  /* Module library: finds the runs of Config::moduleLength gates whose
+   * structure recurs in the most circuits of front and adds the first which
+   * qualifies to the library of the Module gate (see Gates::Module::add),
+   * frozen with the angles of one of the occurrences. Returns the circuits
+   * of front with all occurrences of the run replaced by the new module,
+   * or nothing if no module was added. Needs Module to be one of the
+   * Gene's gates. Must not be called during a parallel evaluation. */
+  template<class Module, class Container>
+  static std::vector<Derived> harvestModules(const Container& front) {
+    using ModuleGate = typename Gene::template GateClass<Module>;
+    if(ModuleGate::count() >= Config::moduleMax)
+      return {};
+    struct Run {
+      size_t count;
+      size_t last;  // last circuit counted
+      const CandidateBase* circ;
+      size_t pos;
+    };
+    const size_t len = Config::moduleLength;
+    std::unordered_map<std::string, Run> runs{};
+    size_t ic = 0;
+    for(const CandidateBase& c : front) {
+      for(size_t k = 0; k + len <= c.gt.size(); k++) {
+        Run& r = runs[runString(c.gt, k)];
+        if(r.count == 0 || r.last != ic) {
+          r.count++;
+          r.last = ic;
+          r.circ = &c;
+          r.pos = k;
+        }
+      }
+      ic++;
+    }
+    std::vector<std::pair<size_t, const std::string*>> order{};
+    for(const auto& r : runs)
+      if(r.second.count >= Config::moduleMinCount)
+        order.push_back({r.second.count, &r.first});
+    std::sort(order.begin(), order.end(),
+        [](const std::pair<size_t, const std::string*>& a,
+          const std::pair<size_t, const std::string*>& b) {
+          return a.first > b.first;
+        });
+    for(const auto& o : order) {
+      const Run& r = runs[*o.second];
+      std::vector<typename Gene::PointerType> gates{};
+      for(size_t k = r.pos; k < r.pos + len; k++)
+        gates.push_back(r.circ->gt[k].get());
+      if(!ModuleGate::add(gates, Config::moduleQubits))
+        continue;
+      Gene module{ModuleGate::get(ModuleGate::count() - 1)};
+      std::vector<Derived> ret{};
+      for(const CandidateBase& c : front) {
+        std::vector<Gene> gtNew{};
+        bool found = false;
+        for(size_t k = 0; k < c.gt.size(); k++)
+          if(k + len <= c.gt.size() && runString(c.gt, k) == *o.second) {
+            gtNew.push_back(module);
+            k += len - 1;
+            found = true;
+          } else
+            gtNew.push_back(c.gt[k]);
+        if(found)
+          ret.push_back({std::move(gtNew)});
+      }
+      return ret;
+    }
+    return {};
+  }
+
+  /* Tunes all continuous parameters of the circuit using a few steps of
+   * L-BFGS with exact gradients. Derived needs to provide
+   *
+   *   static const std::vector<Channel>& channels();
+   *   static double surrogate(const std::vector<Backend::cxd>& a,
+   *       std::vector<Backend::cxd>& w);
+   *
+   * (or channelCount() and channel() instead of the former) where the latter
+   * computes a smooth measure of the error from the
+   * overlaps a of all the channels and fills w such that its differential
+   * equals Re(Σ w[c] da[c]). Returns *this if no change was made. */
+  Derived optimize() const {
+    std::vector<double> x{};
+    for(const auto& g : gt) {
+      std::vector<double> p = g->params();
+      x.insert(x.end(), p.begin(), p.end());
+    }
+    if(x.empty())
+      return derived();
+    std::vector<double> x0{x};
+    internal::LBFGS{}.minimize(x,
+        [this](const std::vector<double>& x, std::vector<double>& grad) {
+          return gradient(withParams(x), grad);
+        }, Config::optSteps);
+    if(x == x0)
+      return derived();
+    return {withParams(x)};
+  }
+
+  /* Returns this circuit carried over to one more qubit, according to the
+   * Lift rules of its gates. Config::nBit must be already increased. */
+  Derived lift() const {
+    std::vector<Gene> gtNew{};
+    for(const auto& g : gt) {
+      std::vector<Gene> lifted = g.lift();
+      gtNew.insert(gtNew.end(), lifted.begin(), lifted.end());
+    }
+    return {std::move(gtNew)};
+  }
+
+  /* Forgets the state of an evaluation which a copy of an evaluated
+   * candidate, e.g. a parent returned unchanged by a genetic operator,
+   * would carry into its own: the rejection, the audit and the brood
+   * checkpoint. What depends only on the genotype is kept. */
+  Derived& clearEvaluation() {
+    rej = false;
+    auditing = false;
+    resume.reset();
+    return static_cast<Derived&>(*this);
+  }
+
   Derived& setOrigin(size_t origin_) {
     if(origin == (size_t)(~0))
       origin = origin_;
@@ -94,6 +351,119 @@ public:
     return gen;
   }
 
+  /* Called once at startup and whenever Config::nBit changes. Problems can
+   * override this to build tables which don't depend on the candidate, but
+   * must call the base version. */
+  static void precompute() {
+    Fingerprint::init();
+  }
+
+  /* The symmetry of the problem: qubits of the same class can be permuted
+   * among themselves without changing the fitness of any circuit. Problems
+   * can override this to return a class for each of the Config::nBit
+   * qubits. Empty (the default) means no symmetry. New candidates are then
+   * relabelled to a representative of their class, see relabelling(), also
+   * when read from user input. */
+  static std::vector<unsigned> qubitClasses() {
+    return {};
+  }
+
+  static const internal::FunctionalCache<double>& errorCache() {
+    return cache();
+  }
+
+  /* The channels of the problem, see optimize(), as used by the gradient,
+   * brood mode and noise. By default they are taken from the table given
+   * by Derived::channels(). A problem with too many channels to keep, e.g.
+   * one per column of a large matrix, can hide both functions and build
+   * each Channel on demand, returning it by value. */
+  static size_t channelCount() {
+    return Derived::channels().size();
+  }
+
+  static const Channel& channel(size_t ic) {
+    return Derived::channels()[ic];
+  }
+
+  /* Sets the fitnesses of the current archive for bounded evaluation (see
+   * tryReject()). Must not be called during a parallel evaluation. */
+  template<class Container>
+  static void setFrontier(const Container& cont) {
+    std::vector<Fitness>& f = frontier();
+    f.clear();
+    for(const auto& c : cont)
+      f.push_back(c.fitness());
+  }
+
+  static void clearFrontier() {
+    frontier().clear();
+  }
+
+  // Number of candidates whose evaluation has been cut short
+  static size_t rejectCount() {
+    return rejects();
+  }
+
+  /* Statistics of screen(). Of the candidates rejected based on an estimate,
+   * a random fraction is audited by an exact evaluation to see how many of
+   * them actually should not have been. */
+  struct ScreenStats {
+    size_t rejected;
+    size_t audited;
+    size_t wrong;
+
+    friend std::ostream& operator<< (std::ostream& os, const ScreenStats& s) {
+      os << s.rejected << " rejected, " << s.audited << " audited, "
+        << s.wrong << " wrongly";
+      if(s.audited > 0)
+        os << " (" << 100.0 * s.wrong / s.audited << "%)";
+      return os;
+    }
+  };
+
+  static const ScreenStats& screenStats() {
+    return sstats();
+  }
+
+  /* Sets the evaluation budget for the candidates of a new generation (see
+   * overBudget()): the length limit is Config::lengthFactor times the
+   * length of the longest member of front, and the count of gate
+   * applications is restarted. Must not be called during a parallel
+   * evaluation. */
+  template<class Container>
+  static void setBudget(const Container& front) {
+    size_t maxLen = 0;
+    for(const auto& c : front)
+      maxLen = std::max(maxLen, c.genotype().size());
+    lengthLimit() = Config::lengthFactor > 0
+      ? (size_t)std::ceil(Config::lengthFactor * maxLen)
+      : Config::maxLength;
+    bstats().spent = 0;
+    budgeting() = true;
+  }
+
+  static void clearBudget() {
+    lengthLimit() = Config::maxLength;
+    budgeting() = false;
+  }
+
+  /* Statistics of overBudget(), counting gate applications in the
+   * current generation and those saved in total by skipping candidates. */
+  struct BudgetStats {
+    size_t skipped;
+    size_t spent;
+    size_t saved;
+
+    friend std::ostream& operator<< (std::ostream& os, const BudgetStats& s) {
+      return os << s.skipped << " candidates skipped, " << s.saved
+        << " gate applications saved";
+    }
+  };
+
+  static const BudgetStats& budgetStats() {
+    return bstats();
+  }
+
 protected:
 
   unsigned controls() const {
@@ -108,13 +478,577 @@ protected:
     return (unsigned long)(error * (1UL<<16)) / (double)(1UL<<16);
   }
 
+  /* Returns the error of this circuit if it is already known, either from
+   * the persistent DiskCache (if open) or from an earlier evaluation of the
+   * same genotype in this run. Otherwise calls eval() and remembers its
+   * result. Only the fitness elements which depend on the circuit's
+   * function rather than its structure (errors) can be memoized this way.
+   * A fingerprint stored along with the error in the DiskCache is taken
+   * over for sameFunc(). */
+  template<class Eval>
+  double memoError(Eval eval) const {
+    DiskCache& disk = DiskCache::global();
+    std::string hs = hashString();
+    DiskCache::Key key{};
+    double error;
+    if(disk) {
+      key = disk.key(hs);
+      if(disk.find(key, error, fp))
+        return error;
+    }
+    std::uint64_t id = internal::fnv1a(hs.data(), hs.length(),
+        internal::fnv1a(&Config::nBit, sizeof(Config::nBit)));
+    if(!cache().find(id, error)) {
+      error = eval();
+      if(rejected())
+        return error;
+      cache().insert(id, error);
+    }
+    if(disk)
+      disk.insert(key, error, fp);
+    return error;
+  }
+
+  /* Bounded evaluation: bound is a fitness known to be no worse than the
+   * final one in any element, e.g., using a partial result for the error.
+   * If some member of the frontier dominates it, the candidate is marked as
+   * rejected and the function returns true, in which case the evaluation
+   * should be stopped and the fitness returned as {}. The result of eval()
+   * given to memoError() is then not remembered. */
+  bool tryReject(const Fitness& bound) const {
+    if(!dominated(bound))
+      return false;
+    rej = true;
+    #pragma omp atomic
+    rejects()++;
+    return true;
+  }
+
+  bool rejected() const {
+    return rej;
+  }
+
+  /* Mean error of the circuit over Config::noiseTraj noisy trajectories, see
+   * internal::Trajectories, each starting in a random channel (see channel()).
+   * Returns 0 if Config::noiseTraj is 0. This can be used as a fitness
+   * element. Unlike memoError(), the result is not remembered because it
+   * depends on the structure of the circuit, not only on its function.
+   * Instead, the trajectories are drawn using a seed derived from the
+   * genotype, so the same circuit always gets the same estimate and
+   * comparisons of fitness don't depend on the luck of the draw. */
+  double noisyError() const {
+    if(Config::noiseTraj == 0)
+      return 0;
+    std::string hs = hashString();
+    std::uint64_t seed = internal::fnv1a(hs.data(), hs.length(),
+        internal::fnv1a(&Config::nBit, sizeof(Config::nBit)));
+    return internal::Trajectories<Genotype, Derived>{gt, seed}
+      .run(Config::noiseTraj);
+  }
+
+  /* Evaluation budget: returns true if the candidate should not be
+   * simulated at all, and its fitness be {}, because it is longer than the
+   * limit set by setBudget() or Config::maxLength, or because the
+   * generation has used up Config::genBudget gate applications (if
+   * nonzero, and only between setBudget() and clearBudget()). Simulating
+   * all the problem's channels takes channels times the length of the
+   * circuit. */
+  bool overBudget(size_t channels) const {
+    size_t cost = channels * gt.size();
+    bool over = gt.size() > std::min(lengthLimit(), Config::maxLength);
+    if(!over && Config::genBudget > 0 && budgeting()) {
+      size_t before;
+      #pragma omp atomic capture
+      { before = bstats().spent; bstats().spent += cost; }
+      over = before + cost > Config::genBudget;
+    }
+    if(over) {
+      #pragma omp critical(QGA_BudgetStats)
+      {
+        bstats().skipped++;
+        bstats().saved += cost;
+      }
+    }
+    return over;
+  }
+
+  /* The output of the circuit for channel(ic), continuing from
+   * a checkpoint of the parent if one has been given. With to, only the
+   * gates before that position are applied; it must not be less than
+   * resumePos(). */
+  Backend::State simChannel(size_t ic, size_t to = (size_t)(~0)) const {
+    const Channel& c = Derived::channel(ic);
+    Backend::State psi{resume ? resume->states[ic] : c.psi};
+    packed().apply(psi, resumePos(), std::min(to, gt.size()), c.ctx);
+    return psi;
+  }
+
+  // Applies the circuit to psi in place
+  void simulate(Backend::State& psi,
+      const typename Gene::ContextType* ctx = nullptr) const {
+    packed().apply(psi, ctx);
+  }
+
+  // Applies gates from to to - 1 to psi in place
+  void simulate(Backend::State& psi, size_t from, size_t to,
+      const typename Gene::ContextType* ctx = nullptr) const {
+    packed().apply(psi, from, to, ctx);
+  }
+
+  /* The genotype compiled for simulation, built on first use. Several
+   * threads can get here at once for a parent in brood mode (see
+   * shareCheckpoints()), so pc is set atomically as in Interned and the
+   * first one built is kept. */
+  const internal::PackedCircuit<Gene>& packed() const {
+    std::shared_ptr<const internal::PackedCircuit<Gene>> ret =
+      std::atomic_load(&pc);
+    if(ret)
+      return *ret;
+    std::shared_ptr<const internal::PackedCircuit<Gene>> made =
+      std::make_shared<internal::PackedCircuit<Gene>>(gt);
+    if(std::atomic_compare_exchange_strong(&pc, &ret, made))
+      return *made;
+    return *ret;
+  }
+
+  // Number of leading gates covered by the checkpoint
+  size_t resumePos() const {
+    return resume ? resume->pos : 0;
+  }
+
+  // Tells whether tryReject() and screen() can do anything at all
+  static bool bounding() {
+    return !frontier().empty();
+  }
+
+  /* Like tryReject() but bound is based on an estimate of the error rather
+   * than a rigorous bound. With probability Config::pAudit the rejection is
+   * turned into an audit: screen() returns false and the evaluation should
+   * continue exactly, followed by a call to audit() with the result. */
+  bool screen(const Fitness& bound) const {
+    if(!dominated(bound))
+      return false;
+    std::uniform_real_distribution<> dUni{};
+    if(dUni(gen::rng) < Config::pAudit) {
+      auditing = true;
+      return false;
+    }
+    rej = true;
+    #pragma omp atomic
+    sstats().rejected++;
+    return true;
+  }
+
+  // Records whether the rejection by screen() was right, if applicable
+  void audit(const Fitness& exact) const {
+    if(!auditing)
+      return;
+    bool wrong = !rej && !dominated(exact);
+    #pragma omp critical(QGA_ScreenStats)
+    {
+      sstats().audited++;
+      sstats().wrong += wrong;
+    }
+  }
+
 private:
 
   const Derived& derived() const {
     return static_cast<const Derived&>(*this);
   }
 
-  std::vector<Gene> gt{};
+  /* The fingerprint of the circuit, using Derived::probe(const
+   * Fingerprint::Probe&), computed on first use. */
+  Fingerprint::Value fingerprint() const {
+    if(fp == 0)
+      fp = Fingerprint::compute([this](const Fingerprint::Probe& p) {
+          return derived().probe(p);
+        });
+    return fp;
+  }
+
+  // The exact check behind sameFunc()
+  static bool sameOutputs(const CandidateBase& lhs, const CandidateBase& rhs) {
+    Backend::cxd phase{};
+    for(size_t ic = 0; ic < Derived::channelCount(); ic++) {
+      const Channel& c = Derived::channel(ic);
+      Backend::State out1{c.psi}, out2{c.psi};
+      lhs.simulate(out1, c.ctx);
+      rhs.simulate(out2, c.ctx);
+      Backend::cxd overlap = Backend::State::overlap(out1, out2);
+      if(ic == 0)
+        phase = overlap;
+      if(std::abs(overlap - phase) > sameTolerance
+          || 1 - std::abs(overlap) > sameTolerance)
+        return false;
+    }
+    return true;
+  }
+
+  static constexpr double sameTolerance = 1e-9;
+
+  static bool dominated(const Fitness& fitness) {
+    for(const Fitness& f : frontier())
+      if(f << fitness)
+        return true;
+    return false;
+  }
+
+  static internal::FunctionalCache<double>& cache() {
+    static internal::FunctionalCache<double> c{};
+    return c;
+  }
+
+  static std::vector<Fitness>& frontier() {
+    static std::vector<Fitness> f{};
+    return f;
+  }
+
+  static size_t& rejects() {
+    static size_t cnt = 0;
+    return cnt;
+  }
+
+  static ScreenStats& sstats() {
+    static ScreenStats s{};
+    return s;
+  }
+
+  static size_t& lengthLimit() {
+    static size_t limit = Config::maxLength;
+    return limit;
+  }
+
+  static bool& budgeting() {
+    static bool b = false;
+    return b;
+  }
+
+  static BudgetStats& bstats() {
+    static BudgetStats s{};
+    return s;
+  }
+
+  // The states of all channels after the first pos gates
+  struct Checkpoint {
+    size_t pos;
+    std::vector<Backend::State> states;
+  };
+
+  std::vector<Gene> withParams(const std::vector<double>& x) const {
+    std::vector<Gene> ret(gt.begin(), gt.end());
+    const double* p = x.data();
+    for(auto& g : ret) {
+      size_t np = g->params().size();
+      if(np > 0) {
+        g.setParams(p);
+        p += np;
+      }
+    }
+    return ret;
+  }
+
+  /* Adjoint differentiation: the state of each channel is simulated forward
+   * and then walked back through the inverted gates together with the
+   * target projected back to the same point, where the overlap with each
+   * gate's derivative gives the corresponding component of the gradient. */
+  static double gradient(const std::vector<Gene>& gtx,
+      std::vector<double>& grad) {
+    size_t nc = Derived::channelCount();
+    std::vector<Backend::State> outs{};
+    std::vector<Backend::cxd> a{}, w{};
+    outs.reserve(nc);
+    internal::PackedCircuit<Gene> pc{gtx};
+    for(size_t ic = 0; ic < nc; ic++) {
+      const Channel& c = Derived::channel(ic);
+      Backend::State psi{c.psi};
+      pc.apply(psi, c.ctx);
+      a.push_back(Backend::State::overlap(c.target, psi));
+      outs.push_back(std::move(psi));
+    }
+    double value = Derived::surrogate(a, w);
+    std::fill(grad.begin(), grad.end(), 0.0);
+    for(size_t ic = 0; ic < nc; ic++) {
+      const Channel& c = Derived::channel(ic);
+      Backend::State& psi = outs[ic];
+      Backend::State lambda{c.target};
+      size_t ip = grad.size();
+      for(size_t k = gtx.size(); k-- > 0; ) {
+        Gene inv{gtx[k]};
+        inv.invert();
+        psi = inv->applyTo(psi, c.ctx);
+        size_t np = gtx[k]->params().size();
+        ip -= np;
+        for(unsigned j = 0; j < np; j++)
+          grad[ip + j] += std::real(w[ic] * Backend::State::overlap(lambda,
+                gtx[k]->applyDiff(psi, j, c.ctx)));
+        lambda = inv->applyTo(lambda, c.ctx);
+      }
+    }
+    return value;
+  }
+
+  /* How a gate acts, for deciding whether two gates commute: the qubits it
+   * acts on and those of them on which it is diagonal (controls and
+   * a diagonal target), as masks of internal::PackedGate, and its packed
+   * form. Gates which can't be packed act on all their qubits() in an
+   * unknown way. */
+  struct Shape {
+    internal::PackedGate p;
+    size_t support;
+    size_t diag;
+  };
+
+  static Shape shape(const Gene& g) {
+    using internal::PackedGate;
+    Shape s{};
+    if(!g->pack(s.p)) {
+      s.p.kind = PackedGate::OTHER;
+      for(unsigned q : g->qubits())
+        s.support |= PackedGate::qubit(q);
+      return s;
+    }
+    switch(s.p.kind) {
+      case PackedGate::CTRL:
+        s.support = s.p.mask1 | s.p.mask2;
+        s.diag = s.p.mask2;
+        if(s.p.mat[1] == 0.0 && s.p.mat[2] == 0.0)
+          s.diag |= s.p.mask1;
+        break;
+      case PackedGate::SWAP:
+        s.support = s.p.mask1 | s.p.mask2;
+        break;
+      default:
+        break;
+    }
+    return s;
+  }
+
+  /* Sufficient conditions for two gates to commute: each qubit they share
+   * is a diagonal one for both, or they are controlled matrices on the same
+   * target (then the other qubits they share are controls of both) and the
+   * matrices commute. Matrices are compared exactly, so this holds for the
+   * discrete gates but rarely for the continuous ones. */
+  static bool commute(const Shape& a, const Shape& b) {
+    using internal::PackedGate;
+    size_t shared = a.support & b.support;
+    if((shared & ~(a.diag & b.diag)) == 0)
+      return true;
+    if(a.p.kind != PackedGate::CTRL || b.p.kind != PackedGate::CTRL
+        || a.p.mask1 != b.p.mask1)
+      return false;
+    const Backend::cxd *m = a.p.mat, *n = b.p.mat;
+    for(unsigned i = 0; i < 2; i++)
+      for(unsigned j = 0; j < 2; j++)
+        if(m[2*i] * n[j] + m[2*i + 1] * n[2 + j]
+            != n[2*i] * m[j] + n[2*i + 1] * m[2 + j])
+          return false;
+    return true;
+  }
+
+  /* The order of commuting gates in the canonical form: the ones acting on
+   * lower qubits go first. */
+  static bool before(const Shape& a, const Shape& b) {
+    return a.support > b.support;
+  }
+
+  // A per-thread work area for canonical() and isCanonical()
+  static std::vector<Shape>& shapes() {
+    static thread_local std::vector<Shape> buf{};
+    buf.clear();
+    return buf;
+  }
+
+  // Whether the current thread is within a KeepLabels scope
+  static bool& keepLabels() {
+    static thread_local bool keep = false;
+    return keep;
+  }
+
+  // Number of leading genes which a and b have in common
+  static size_t commonPrefix(const Genotype& a, const Genotype& b) {
+    size_t p = 0;
+    auto it1 = a.begin(), it2 = b.begin();
+    while(p < a.size() && p < b.size() && *it1++ == *it2++)
+      p++;
+    return p;
+  }
+
+  // Transpositions of qubits, applied in order by relabel()
+  using Swaps = std::vector<std::pair<unsigned, unsigned>>;
+
+  /* Qubit symmetry: the transpositions which number the qubits in each
+   * class of Derived::qubitClasses() by their first appearance in the
+   * circuit, controls before the target and lower indices first within
+   * a gate. Unused qubits take the remaining labels in ascending order.
+   * Circuits which only differ by a permutation of qubits within the
+   * classes are usually relabelled to the same circuit, which then shares
+   * their memoized fitness and is pruned as a duplicate. Symmetric gates
+   * like SWAP can leave twins apart, but never join circuits which are not
+   * twins. */
+  template<class Iter>
+  static Swaps relabelling(Iter it, Iter end) {
+    using internal::PackedGate;
+    std::vector<unsigned> cls = Derived::qubitClasses();
+    if(cls.empty())
+      return {};
+    unsigned n = Config::nBit, left = n;
+    std::vector<unsigned> label(n, n);
+    std::vector<bool> taken(n, false);
+    auto give = [&](unsigned q) {
+      if(label[q] != n)
+        return;
+      unsigned l = 0;
+      while(taken[l] || cls[l] != cls[q])
+        l++;
+      taken[l] = true;
+      label[q] = l;
+      left--;
+    };
+    for( ; it != end && left > 0; ++it) {
+      Shape s = shape(*it);
+      size_t first = s.p.kind == PackedGate::CTRL ? s.p.mask2 : s.support;
+      for(unsigned q = 0; q < n; q++)
+        if(first & PackedGate::qubit(q))
+          give(q);
+      for(unsigned q = 0; q < n; q++)
+        if(s.support & PackedGate::qubit(q))
+          give(q);
+    }
+    for(unsigned q = 0; q < n; q++)
+      give(q);
+    // at: current label of each qubit, who: inverse
+    std::vector<unsigned> at(n), who(n);
+    for(unsigned q = 0; q < n; q++)
+      at[q] = who[q] = q;
+    Swaps ret{};
+    for(unsigned q = 0; q < n; q++) {
+      unsigned l = label[q], m = at[q], r = who[l];
+      if(m == l)
+        continue;
+      ret.push_back({l, m});
+      at[q] = l;
+      who[l] = q;
+      at[r] = m;
+      who[m] = r;
+    }
+    return ret;
+  }
+
+  static void relabel(std::vector<Gene>& work, const Swaps& swaps) {
+    if(swaps.empty())
+      return;
+    for(Gene& g : work)
+      for(const auto& sw : swaps)
+        g.swapQubits(sw.first, sw.second);
+  }
+
+  /* Brings the genes of work to the canonical form, leaving work empty.
+   * Each gene is moved back past the preceding genes it commutes with, at
+   * most Config::canonWindow of them, and merged with the first one it can
+   * merge with. If there is none, it stops after the last one which comes
+   * before it in the order of before(). Trivial genes, including results
+   * of merges, are dropped. This costs O(size * Config::canonWindow) cheap
+   * tests, far less than simulating the circuit. */
+  static Genotype canonical(std::vector<Gene>& work) {
+    std::vector<Shape>& shs = shapes();
+    size_t n = 0;   // work[0] to work[n - 1] are kept, shs are their shapes
+    for(size_t cur = 0; cur < work.size(); cur++) {
+      if(work[cur]->isTrivial())
+        continue;
+      Shape s = shape(work[cur]);
+      size_t lo = n > Config::canonWindow ? n - Config::canonWindow : 0;
+      bool merged = false;
+      size_t j;
+      for(j = n; j > lo; j--) {
+        if(work[j - 1].merge(work[cur])) {
+          merged = true;
+          break;
+        }
+        if(!commute(shs[j - 1], s))
+          break;
+      }
+      if(merged) {
+        size_t k = j - 1;
+        if(work[k]->isTrivial()) {
+          std::rotate(work.begin() + k, work.begin() + k + 1, work.begin() + n);
+          shs.erase(shs.begin() + k);
+          n--;
+        } else
+          shs[k] = shape(work[k]);
+        continue;
+      }
+      size_t ins = n;
+      while(ins > lo && commute(shs[ins - 1], s) && before(s, shs[ins - 1]))
+        ins--;
+      // work[n] to work[cur - 1] are not used anymore
+      std::swap(work[n], work[cur]);
+      std::rotate(work.begin() + ins, work.begin() + n, work.begin() + n + 1);
+      shs.insert(shs.begin() + ins, s);
+      n++;
+    }
+    Genotype ret{work.begin(), work.begin() + n};
+    work.clear();
+    return ret;
+  }
+
+  /* Whether canonical() would leave gt as it is. This is decided before
+   * any merge is tried, so a pair of genes of sameType() counts as
+   * a change even if they don't merge. */
+  static bool isCanonical(const Genotype& gt) {
+    std::vector<Shape>& shs = shapes();
+    size_t n = 0;
+    for(auto it = gt.begin(), end = gt.end(); it != end; ++it, n++) {
+      if((*it)->isTrivial())
+        return false;
+      Shape s = shape(*it);
+      size_t lo = n > Config::canonWindow ? n - Config::canonWindow : 0;
+      auto prev = it;
+      for(size_t j = n; j > lo; j--) {
+        if(sameType(*--prev, *it))
+          return false;
+        if(!commute(shs[j - 1], s))
+          break;
+      }
+      if(n > 0 && commute(shs[n - 1], s) && before(s, shs[n - 1]))
+        return false;
+      shs.push_back(s);
+    }
+    return true;
+  }
+
+  /* Text of genes gt[pos] to gt[pos + Config::moduleLength - 1] without
+   * anything in parentheses, i.e., their structure but not their angles,
+   * which are almost never exactly repeated. */
+  static std::string runString(const Genotype& gt, size_t pos) {
+    std::ostringstream os{};
+    auto it = gt.begin() + pos;
+    for(size_t k = 0; k < Config::moduleLength; k++)
+      os << *it++ << ';';
+    std::string ret{};
+    unsigned depth = 0;
+    for(char c : os.str()) {
+      depth += c == '(';
+      if(depth == 0)
+        ret.push_back(c);
+      depth -= c == ')';
+    }
+    return ret;
+  }
+
+  // The genotype written in full precision, identifying it across runs
+  std::string hashString() const {
+    std::ostringstream os{};
+    os << std::setprecision(17) << *this;
+    return os.str();
+  }
+
+  Genotype gt;
+  mutable Fingerprint::Value fp = 0;
+  mutable bool rej = false;
+  mutable bool auditing = false;
+  mutable std::shared_ptr<const Checkpoint> resume{};
+  mutable std::shared_ptr<const internal::PackedCircuit<Gene>> pc{};
   size_t origin = (size_t)(~0);
   unsigned long gen = (unsigned long)(~0);
 
@@ -39,6 +39,8 @@ template<
 class CandidateFactory {
 
   using Gene = typename Candidate::GeneType;
+  using Genotype = typename Candidate::Genotype;
+  using Builder = typename Genotype::Builder;
 
   friend class GenOpCounter<CandidateFactory>;
 
@@ -52,23 +54,63 @@ public:
     // probability of termination; expLengthIni = expected number of genes
     const double probTerm = 1/Config::expLengthIni;
     std::uniform_real_distribution<> dUni{};
-    std::vector<Gene> gtOrig{};
-    gtOrig.reserve(Config::expLengthIni);
+    std::vector<Gene>& gtNew = buffer();
+    gtNew.reserve(Config::expLengthIni);
     do
-      gtOrig.push_back(Gene::getRandom());
+      gtNew.push_back(Gene::getRandom());
     while(dUni(gen::rng) > probTerm);
-    return Candidate{std::move(gtOrig)};
+    return Candidate{std::move(gtNew)};
   }
 
   Candidate getNew() {
-    std::uniform_int_distribution<size_t> dUni{0, ops.size() - 1};
+    std::uniform_int_distribution<size_t> dUni{0, opCount() - 1};
     size_t index = dUni(gen::rng);
-    return (this->*ops[index].fun)().setOrigin(index);
+    return (this->*ops[index].fun)().clearEvaluation().setOrigin(index);
+  }
+
+  /* Selects a single parent and makes k children of it using random
+   * operators. (Those taking more parents select the others as usual.) The
+   * children are prepared to share the simulation of the parent's common
+   * part, see CandidateBase::shareCheckpoints(). */
+  std::vector<Candidate> getBrood(size_t k) {
+    const Candidate& parent = get();
+    CandidateFactory local{*this};
+    std::uniform_int_distribution<size_t> dUni{0, opCount() - 1};
+    std::vector<Candidate> ret{};
+    ret.reserve(k);
+    {
+      typename Candidate::KeepLabels keep{};
+      for(size_t i = 0; i < k; i++) {
+        size_t index = dUni(gen::rng);
+        local.fixed = &parent;
+        ret.push_back((local.*ops[index].fun)()
+            .clearEvaluation().setOrigin(index));
+      }
+    }
+    Candidate::shareCheckpoints(parent, ret);
+    return ret;
   }
 
 private:
 
+  /* A per-thread work area for genes which are not taken from a parent
+   * as they are. It is returned empty but keeps its capacity, and
+   * Candidate's constructor leaves it so, so it doesn't allocate once it
+   * has grown. There is a single buffer per thread: every operator builds
+   * one child at a time and the Candidate is constructed before the next
+   * call, so no two uses overlap. */
+  static std::vector<Gene>& buffer() {
+    static thread_local std::vector<Gene> buf{};
+    buf.clear();
+    return buf;
+  }
+
   const Candidate& get() {
+    if(fixed) {
+      const Candidate* ret = fixed;
+      fixed = nullptr;
+      return *ret;
+    }
     return pop.NSGASelect(Config::selectBias);
   }
 
@@ -78,13 +120,16 @@ private:
     auto sz = gtOrig.size();
     if(sz == 0)
       return parent;
-    auto gtNew = gtOrig;
+    Genotype gtNew{gtOrig};
     std::uniform_real_distribution<> dUni{};
     std::uniform_int_distribution<size_t> dPos{0, sz - 1};
     const double probTerm = 1/Config::expMutationCount;
-    do
-      gtNew[dPos(gen::rng)].getAnother();
-    while(dUni(gen::rng) > probTerm);
+    do {
+      size_t pos = dPos(gen::rng);
+      Gene g{gtNew[pos]};
+      g.getAnother();
+      gtNew.set(pos, std::move(g));
+    } while(dUni(gen::rng) > probTerm);
     return Candidate{std::move(gtNew)};
   }
 
@@ -94,14 +139,21 @@ private:
     auto sz = gtOrig.size();
     if(sz == 0)
       return parent;
-    auto gtNew = gtOrig;
+    Genotype gtNew{gtOrig};
+    bool changed = false;
     std::uniform_real_distribution<> dUni{};
     std::uniform_int_distribution<size_t> dPos{0, sz - 1};
     const double probTerm = 1/Config::expMutationCount;
-    do
-      gtNew[dPos(gen::rng)].mutate();
-    while(dUni(gen::rng) > probTerm);
-    return gtNew != gtOrig ? Candidate{std::move(gtNew)} : parent;
+    do {
+      size_t pos = dPos(gen::rng);
+      Gene g{gtNew[pos]};
+      g.mutate();
+      if(!(g == gtNew[pos])) {
+        gtNew.set(pos, std::move(g));
+        changed = true;
+      }
+    } while(dUni(gen::rng) > probTerm);
+    return changed ? Candidate{std::move(gtNew)} : parent;
   }
 
   Candidate mAddSingle() {
@@ -110,12 +162,11 @@ private:
     auto sz = gtOrig.size();
     std::uniform_int_distribution<size_t> dPos{0, sz};
     size_t pos = dPos(gen::rng);
-    std::vector<Gene> gtNew{};
-    gtNew.reserve(sz + 1);
-    gtNew.insert(gtNew.end(), gtOrig.begin(), gtOrig.begin() + pos);
-    gtNew.insert(gtNew.end(), Gene::getRandom());
-    gtNew.insert(gtNew.end(), gtOrig.begin() + pos, gtOrig.end());
-    return Candidate{std::move(gtNew)};
+    Builder gtNew{};
+    gtNew.append(gtOrig, 0, pos);
+    gtNew.push_back(Gene::getRandom());
+    gtNew.append(gtOrig, pos, sz);
+    return Candidate{gtNew.build()};
   }
 
   Candidate mAddSlice() {
@@ -125,18 +176,14 @@ private:
     std::uniform_real_distribution<> dUni{};
     std::uniform_int_distribution<size_t> dPos{0, sz};
     size_t pos = dPos(gen::rng);
-    std::vector<Gene> ins{};
-    ins.reserve(2*Config::expSliceLength);
+    Builder gtNew{};
+    gtNew.append(gtOrig, 0, pos);
     double probTerm = 1/Config::expSliceLength;
     do
-      ins.push_back(Gene::getRandom());
+      gtNew.push_back(Gene::getRandom());
     while(dUni(gen::rng) > probTerm);
-    std::vector<Gene> gtNew{};
-    gtNew.reserve(sz + ins.size());
-    gtNew.insert(gtNew.end(), gtOrig.begin(), gtOrig.begin() + pos);
-    gtNew.insert(gtNew.end(), ins.begin(), ins.end());
-    gtNew.insert(gtNew.end(), gtOrig.begin() + pos, gtOrig.end());
-    return Candidate{std::move(gtNew)};
+    gtNew.append(gtOrig, pos, sz);
+    return Candidate{gtNew.build()};
   }
 
   Candidate mAddPairs() {
@@ -149,24 +196,21 @@ private:
            pos2 = dPos(gen::rng);
     if(pos2 < pos1)
       std::swap(pos1, pos2);
-    std::vector<Gene> ins{};
+    std::vector<Gene>& ins = buffer();
     ins.reserve(2*Config::expSliceLength);
     double probTerm = 1/Config::expSliceLength;
     do
       ins.push_back(Gene::getRandom());
     while(dUni(gen::rng) > probTerm);
-    std::vector<Gene> gtNew{};
-    gtNew.reserve(sz + 2*ins.size());
-    gtNew.insert(gtNew.end(), gtOrig.begin(), gtOrig.begin() + pos1);
-    gtNew.insert(gtNew.end(), ins.begin(), ins.end());
-    gtNew.insert(gtNew.end(), gtOrig.begin() + pos1, gtOrig.begin() + pos2);
+    Builder gtNew{};
+    gtNew.append(gtOrig, 0, pos1);
+    gtNew.append(ins.begin(), ins.end());
+    gtNew.append(gtOrig, pos1, pos2);
     for(auto& g : ins)
       g.invert();
-    gtNew.insert(gtNew.end(),
-        std::make_move_iterator(ins.rbegin()),
-        std::make_move_iterator(ins.rend()));
-    gtNew.insert(gtNew.end(), gtOrig.begin() + pos2, gtOrig.end());
-    return Candidate{std::move(gtNew)};
+    gtNew.append(ins.rbegin(), ins.rend());
+    gtNew.append(gtOrig, pos2, sz);
+    return Candidate{gtNew.build()};
   }
 
   Candidate mMutateAddPair() {
@@ -180,16 +224,15 @@ private:
     Gene gOrig{gtOrig[pos]};
     gOrig.getAnother();
     Gene gNew{Gene::getRandom()};
-    std::vector<Gene> gtNew{};
-    gtNew.reserve(sz + 2);
-    gtNew.insert(gtNew.end(), gtOrig.begin(), gtOrig.begin() + pos);
+    Builder gtNew{};
+    gtNew.append(gtOrig, 0, pos);
     gtNew.push_back(gNew);
     gtNew.push_back(std::move(gOrig));
     Gene gNewInv{gNew};
     gNewInv.invert();
     gtNew.push_back(std::move(gNewInv));
-    gtNew.insert(gtNew.end(), gtOrig.begin() + pos + 1, gtOrig.end());
-    return Candidate{std::move(gtNew)};
+    gtNew.append(gtOrig, pos + 1, sz);
+    return Candidate{gtNew.build()};
   }
 
   Candidate mSwapQubits() {
@@ -208,10 +251,16 @@ private:
              s2 = dBit(gen::rng);
     // ensure that the two qubit indices are unequal
     s2 += s2 >= s1;
-    std::vector<Gene> gtNew{gtOrig};
-    for(size_t pos = pos1; pos < pos2; pos++)
-      gtNew[pos].swapQubits(s1, s2);
-    return Candidate{std::move(gtNew)};
+    Builder gtNew{};
+    gtNew.append(gtOrig, 0, pos1);
+    for(auto it = gtOrig.begin() + pos1, end = gtOrig.begin() + pos2;
+        it != end; it++) {
+      Gene g{*it};
+      g.swapQubits(s1, s2);
+      gtNew.push_back(std::move(g));
+    }
+    gtNew.append(gtOrig, pos2, sz);
+    return Candidate{gtNew.build()};
   }
 
   Candidate mDeleteSlice() {
@@ -225,11 +274,10 @@ private:
     size_t pos1 = dPos(gen::rng),
            len = 1 + dGeom(gen::rng),
            pos2 = pos1 + len > sz ? sz : pos1 + len;
-    std::vector<Gene> gtNew{};
-    gtNew.reserve(sz - (pos2 - pos1));
-    gtNew.insert(gtNew.end(), gtOrig.begin(), gtOrig.begin() + pos1);
-    gtNew.insert(gtNew.end(), gtOrig.begin() + pos2, gtOrig.end());
-    return Candidate{std::move(gtNew)};
+    Builder gtNew{};
+    gtNew.append(gtOrig, 0, pos1);
+    gtNew.append(gtOrig, pos2, sz);
+    return Candidate{gtNew.build()};
   }
 
   Candidate mReplaceSlice() {
@@ -244,18 +292,14 @@ private:
     size_t pos1 = dPos(gen::rng),
            len = 1 + dGeom(gen::rng),
            pos2 = pos1 + len > sz ? sz : pos1 + len;
-    std::vector<Gene> ins{};
-    ins.reserve(2*Config::expSliceLength);
+    Builder gtNew{};
+    gtNew.append(gtOrig, 0, pos1);
     double probTerm = 1/Config::expSliceLength;
     do
-      ins.push_back(Gene::getRandom());
+      gtNew.push_back(Gene::getRandom());
     while(dUni(gen::rng) > probTerm);
-    std::vector<Gene> gtNew{};
-    gtNew.reserve(sz - (pos2 - pos1) + ins.size());
-    gtNew.insert(gtNew.end(), gtOrig.begin(), gtOrig.begin() + pos1);
-    gtNew.insert(gtNew.end(), ins.begin(), ins.end());
-    gtNew.insert(gtNew.end(), gtOrig.begin() + pos2, gtOrig.end());
-    return Candidate{std::move(gtNew)};
+    gtNew.append(gtOrig, pos2, sz);
+    return Candidate{gtNew.build()};
   }
 
   Candidate mDeleteUniform() {
@@ -263,16 +307,17 @@ private:
     auto &gtOrig = parent.genotype();
     auto sz = gtOrig.size();
     std::uniform_real_distribution<> dUni{};
-    std::vector<Gene> gtNew{};
-    gtNew.reserve(gtOrig.size());
-    size_t cnt = 0;
+    Builder gtNew{};
+    size_t cnt = 0, from = 0;
     double prob = double(Config::expMutationCount) / sz;
-    for(auto& g : gtOrig)
-      if(dUni(gen::rng) >= prob)
-        gtNew.push_back(g);
-      else
+    for(size_t pos = 0; pos < sz; pos++)
+      if(dUni(gen::rng) < prob) {
+        gtNew.append(gtOrig, from, pos);
+        from = pos + 1;
         cnt++;
-    return cnt ? Candidate{std::move(gtNew)} : parent;
+      }
+    gtNew.append(gtOrig, from, sz);
+    return cnt ? Candidate{gtNew.build()} : parent;
   }
 
   Candidate mSplitSwap() {
@@ -288,18 +333,13 @@ private:
     std::sort(pos.begin(), pos.end());
     // ensure that pos[1]-pos[0] and pos[3]-pos[2] are nonzero
     pos[1]++, pos[2]++, pos[3] += 2;
-    std::vector<Gene> gtNew{};
-    gtNew.reserve(sz);
-    gtNew.insert(gtNew.end(),
-        gtOrig.begin(), gtOrig.begin() + pos[0]);
-    gtNew.insert(gtNew.end(),
-        gtOrig.begin() + pos[2], gtOrig.begin() + pos[3]);
-    gtNew.insert(gtNew.end(),
-        gtOrig.begin() + pos[1], gtOrig.begin() + pos[2]);
-    gtNew.insert(gtNew.end(),
-        gtOrig.begin() + pos[0], gtOrig.begin() + pos[1]);
-    gtNew.insert(gtNew.end(), gtOrig.begin() + pos[3], gtOrig.end());
-    return Candidate{std::move(gtNew)};
+    Builder gtNew{};
+    gtNew.append(gtOrig, 0, pos[0]);
+    gtNew.append(gtOrig, pos[2], pos[3]);
+    gtNew.append(gtOrig, pos[1], pos[2]);
+    gtNew.append(gtOrig, pos[0], pos[1]);
+    gtNew.append(gtOrig, pos[3], sz);
+    return Candidate{gtNew.build()};
   }
 
   Candidate mReverseSlice() {
@@ -315,19 +355,16 @@ private:
       std::swap(pos1, pos2);
     // ensure that pos2-pos1 is at least 2
     pos2 += 2;
-    std::vector<Gene> gtNew{};
-    gtNew.reserve(sz);
-    gtNew.insert(gtNew.end(), gtOrig.begin(), gtOrig.begin() + pos1);
-    {
-      auto prev_end = gtNew.end();
-      gtNew.insert(gtNew.end(),
-          gtOrig.rbegin() + sz - pos2, gtOrig.rbegin() + sz - pos1);
-      auto end = gtNew.end();
-      for(auto it = prev_end; it != end; it++)
-        it->invert();
+    Builder gtNew{};
+    gtNew.append(gtOrig, 0, pos1);
+    for(auto it = gtOrig.begin() + pos2, begin = gtOrig.begin() + pos1;
+        it != begin; ) {
+      Gene g{*--it};
+      g.invert();
+      gtNew.push_back(std::move(g));
     }
-    gtNew.insert(gtNew.end(), gtOrig.begin() + pos2, gtOrig.end());
-    return Candidate{std::move(gtNew)};
+    gtNew.append(gtOrig, pos2, sz);
+    return Candidate{gtNew.build()};
   }
 
   Candidate mPermuteSlice() {
@@ -341,9 +378,14 @@ private:
     size_t pos1 = dPos(gen::rng),
            len = 2 + dGeom(gen::rng),
            pos2 = pos1 + len > sz ? sz : pos1 + len;
-    std::vector<Gene> gtNew = gtOrig;
-    std::shuffle(gtNew.begin() + pos1, gtNew.begin() + pos2, gen::rng);
-    return Candidate{std::move(gtNew)};
+    std::vector<Gene>& slice = buffer();
+    slice.assign(gtOrig.begin() + pos1, gtOrig.begin() + pos2);
+    std::shuffle(slice.begin(), slice.end(), gen::rng);
+    Builder gtNew{};
+    gtNew.append(gtOrig, 0, pos1);
+    gtNew.append(slice.begin(), slice.end());
+    gtNew.append(gtOrig, pos2, sz);
+    return Candidate{gtNew.build()};
   }
 
   Candidate mSwapTwo() {
@@ -357,8 +399,9 @@ private:
     size_t pos1 = dPos(gen::rng),
            len = 1 + dGeom(gen::rng),
            pos2 = pos1 + len > sz - 1 ? sz - 1 : pos1 + len;
-    std::vector<Gene> gtNew = gtOrig;
-    swap(gtNew[pos1], gtNew[pos2]);
+    Genotype gtNew{gtOrig};
+    gtNew.set(pos1, gtOrig[pos2]);
+    gtNew.set(pos2, gtOrig[pos1]);
     return Candidate{std::move(gtNew)};
   }
   
@@ -376,18 +419,17 @@ private:
     // ensure that pos2-pos1 is at least 1
     pos2 += 1;
     std::bernoulli_distribution dir{};
-    std::vector<Gene> gtNew{};
-    gtNew.reserve(sz);
-    gtNew.insert(gtNew.end(), gtOrig.begin(), gtOrig.begin() + pos1);
+    Builder gtNew{};
+    gtNew.append(gtOrig, 0, pos1);
     if(dir(gen::rng)) { // move first to end
-      gtNew.insert(gtNew.end(), gtOrig.begin() + pos1 + 1, gtOrig.begin() + pos2);
-      gtNew.insert(gtNew.end(), gtOrig.begin() + pos1, gtOrig.begin() + pos1 + 1);
+      gtNew.append(gtOrig, pos1 + 1, pos2);
+      gtNew.append(gtOrig, pos1, pos1 + 1);
     } else { // move last to beginning
-      gtNew.insert(gtNew.end(), gtOrig.begin() + pos2 - 1, gtOrig.begin() + pos2);
-      gtNew.insert(gtNew.end(), gtOrig.begin() + pos1, gtOrig.begin() + pos2 - 1);
+      gtNew.append(gtOrig, pos2 - 1, pos2);
+      gtNew.append(gtOrig, pos1, pos2 - 1);
     }
-    gtNew.insert(gtNew.end(), gtOrig.begin() + pos2, gtOrig.end());
-    return Candidate{std::move(gtNew)};
+    gtNew.append(gtOrig, pos2, sz);
+    return Candidate{gtNew.build()};
   }
 
   Candidate mRepeatSlice() {
@@ -403,13 +445,12 @@ private:
       std::swap(pos1, pos2);
     // ensure that pos2-pos1 is at least 1
     pos2 += 1;
-    std::vector<Gene> gtNew{};
-    gtNew.reserve(sz + pos2 - pos1);
-    gtNew.insert(gtNew.end(), gtOrig.begin(), gtOrig.begin() + pos1);
-    gtNew.insert(gtNew.end(), gtOrig.begin() + pos1, gtOrig.begin() + pos2);
-    gtNew.insert(gtNew.end(), gtOrig.begin() + pos1, gtOrig.begin() + pos2);
-    gtNew.insert(gtNew.end(), gtOrig.begin() + pos2, gtOrig.end());
-    return Candidate{std::move(gtNew)};
+    Builder gtNew{};
+    gtNew.append(gtOrig, 0, pos1);
+    gtNew.append(gtOrig, pos1, pos2);
+    gtNew.append(gtOrig, pos1, pos2);
+    gtNew.append(gtOrig, pos2, sz);
+    return Candidate{gtNew.build()};
   }
 
   Candidate crossoverUniform() {
@@ -426,9 +467,8 @@ private:
            pCross2 = std::min(Config::expMutationCount / sz2, 1.0);
     std::geometric_distribution<size_t> dGeom1{pCross1};
     std::geometric_distribution<size_t> dGeom2{pCross2};
-    std::vector<Gene> gtNew{};
+    Builder gtNew{};
 
-    gtNew.reserve(std::max(sz1, sz2));
     for(;;) {
       // Take roughly expLen1 genes from gt1
       size_t upto = pos1 + dGeom1(gen::rng) + 1;
@@ -438,7 +478,7 @@ private:
       pos2 += dGeom2(gen::rng) + 1;
       if(pos2 > sz2)
         break; // ditto
-      gtNew.insert(gtNew.end(), gt1->begin() + pos1, gt1->begin() + upto);
+      gtNew.append(*gt1, pos1, upto);
       pos1 = upto;
       // Swap the two
       std::swap(gt1, gt2);
@@ -449,9 +489,9 @@ private:
     // If we get here then either more was requested of gt1 than available or
     // gt2 went empty. In either case, we just take whatever's left and we
     // finish the crossover operation.
-    gtNew.insert(gtNew.end(), gt1->begin() + pos1, gt1->end());
+    gtNew.append(*gt1, pos1, sz1);
 
-    return Candidate{std::move(gtNew)};
+    return Candidate{gtNew.build()};
   }
 
   Candidate concat3() {
@@ -461,18 +501,15 @@ private:
     auto &gt1 = parent1.genotype(),
          &gt2 = parent2.genotype(),
          &gt3 = parent3.genotype();
-    std::vector<Gene> gtNew{};
-    gtNew.reserve(gt1.size() + gt2.size() + gt3.size());
-    gtNew.insert(gtNew.end(), gt1.begin(), gt1.end());
-    {
-      auto start = gtNew.end();
-      gtNew.insert(gtNew.end(), gt2.rbegin(), gt2.rend());
-      auto end = gtNew.end();
-      for(auto it = start; it != end; it++)
-        it->invert();
+    Builder gtNew{};
+    gtNew.append(gt1);
+    for(auto it = gt2.end(), begin = gt2.begin(); it != begin; ) {
+      Gene g{*--it};
+      g.invert();
+      gtNew.push_back(std::move(g));
     }
-    gtNew.insert(gtNew.end(), gt3.begin(), gt3.end());
-    return Candidate{std::move(gtNew)};
+    gtNew.append(gt3);
+    return Candidate{gtNew.build()};
   }
 
   Candidate simplify() {
@@ -484,11 +521,22 @@ private:
     std::uniform_real_distribution<> dUni{};
     std::uniform_int_distribution<size_t> dPos{0, sz - 1};
     const double probTerm = 1/Config::expMutationCount;
-    std::vector<Gene> gtNew = gtOrig;
-    do
-      gtNew[dPos(gen::rng)].simplify();
-    while(dUni(gen::rng) > probTerm);
-    return gtNew != gtOrig ? Candidate{std::move(gtNew)} : parent;
+    Genotype gtNew{gtOrig};
+    bool changed = false;
+    do {
+      size_t pos = dPos(gen::rng);
+      Gene g{gtNew[pos]};
+      g.simplify();
+      if(!(g == gtNew[pos])) {
+        gtNew.set(pos, std::move(g));
+        changed = true;
+      }
+    } while(dUni(gen::rng) > probTerm);
+    return changed ? Candidate{std::move(gtNew)} : parent;
+  }
+
+  Candidate mOptimize() {
+    return get().optimize();
   }
 
   struct GenOp {
@@ -499,7 +547,13 @@ private:
 
   };
 
-  static constexpr std::array<GenOp, 12> ops{{
+  /* The number of ops in use: the last one, mOptimize, is only useful if
+   * some of the gates have continuous parameters. */
+  static constexpr size_t opCount() {
+    return Gene::parametric() ? ops.size() : ops.size() - 1;
+  }
+
+  static constexpr std::array<GenOp, 13> ops{{
     { &CandidateFactory::mAlterDiscrete,   "MDiscrete" },
     { &CandidateFactory::mAlterContinuous, "MContns" },
   //{ &CandidateFactory::mAddSingle,       "AddSingle" },
@@ -517,11 +571,13 @@ private:
     { &CandidateFactory::mMoveGate,        "MoveGate" },
   //{ &CandidateFactory::mRepeatSlice,     "ReptSlice" },
     { &CandidateFactory::crossoverUniform, "C/Over"   },
+    { &CandidateFactory::mOptimize,        "LBFGS"    },
   //{ &CandidateFactory::concat3,          "Concat3"  },
   //{ &CandidateFactory::simplify,         "Simplify" }
   }};
 
   Population& pop;
+  const Candidate* fixed = nullptr;  // next parent to use in getBrood()
 
 }; // class CandidateFactory
 
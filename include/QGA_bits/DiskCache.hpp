@@ -0,0 +1,264 @@
+namespace QGA {
+
+/* A persistent table of fitness results, shared by all runs using the same
+ * file. It is a memory-mapped, append-only open-addressing hash table: keys
+ * are hashes of the textual genotype combined with the problem name and
+ * nBit, values are the error part of fitness along with the circuit's
+ * functional fingerprint. Entries are never removed or overwritten, which
+ * makes it possible to access the table from several processes at once
+ * using just atomic operations on the shared mapping: a slot is claimed by
+ * setting its key and becomes visible to readers when its value is stored.
+ *
+ * The table has a fixed capacity given when the file is created. Once it is
+ * filled to maxLoad, further insertions are ignored; the cachetool utility
+ * can be used to inspect a file and to rebuild it with a larger capacity. */
+
+class DiskCache {
+
+public:
+
+  using Key = std::uint64_t;
+
+  static constexpr unsigned maxNames = 16;
+
+  struct Header {
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t nNames;
+    std::uint64_t capacity;  // number of slots, a power of 2
+    std::uint64_t count;     // number of claimed slots
+    std::uint32_t tags[maxNames];
+    char names[maxNames][24];
+  };
+
+  struct Slot {
+    Key key;                 // 0 = free
+    std::uint64_t value;     // bitwise negation of error, 0 = not ready
+    std::uint64_t fp;        // Fingerprint::Value, 0 = not known
+    std::uint32_t tag;       // hash of the problem name
+    std::uint32_t nBit;
+  };
+
+  struct Entry {
+    Key key;
+    double error;
+    std::uint64_t fp;
+    std::uint32_t tag;
+    std::uint32_t nBit;
+  };
+
+  DiskCache() = default;
+
+  // Open the file for use with a given problem, creating it if needed.
+  DiskCache(const std::string& file, const std::string& problem,
+      size_t capacity = defCapacity):
+    map(file, true, sizeof(Header) + capacity * sizeof(Slot)),
+    tag(internal::fnv1a(problem.data(), problem.length()))
+  {
+    map.lock();
+    if(map.size() < sizeof(Header) + 2 * sizeof(Slot)) {
+      map.unlock();
+      throw std::runtime_error(file + ": not a cache file");
+    }
+    if(std::memcmp(header().magic, magic(), sizeof(Header::magic)) != 0) {
+      /* Fresh file, as extended with zeros by MappedFile, here or by
+       * another process which has not written the header yet. Anything
+       * else is not ours to overwrite. */
+      if(!fresh()) {
+        map.unlock();
+        throw std::runtime_error(file + ": not a cache file");
+      }
+      // Capacity is given by the file size
+      size_t cap = 1;
+      while(sizeof(Header) + 2 * cap * sizeof(Slot) <= map.size())
+        cap *= 2;
+      header().version = version;
+      header().capacity = cap;
+      std::memcpy(header().magic, magic(), sizeof(Header::magic));
+    }
+    if(header().version != version) {
+      map.unlock();
+      throw std::runtime_error(file + ": unsupported cache file version");
+    }
+    registerName(problem);
+    map.unlock();
+    mask = header().capacity - 1;
+  }
+
+  // Open an existing file read-only (for inspection).
+  explicit DiskCache(const std::string& file): map(file, false), tag(0) {
+    if(!map || map.size() < sizeof(Header)
+        || std::memcmp(header().magic, magic(), sizeof(Header::magic)) != 0)
+      throw std::runtime_error(file + ": not a cache file");
+    mask = header().capacity - 1;
+  }
+
+  // The instance used by CandidateBase, inactive unless opened in main()
+  static DiskCache& global() {
+    static DiskCache c{};
+    return c;
+  }
+
+  explicit operator bool() const {
+    return bool(map);
+  }
+
+  Key key(const std::string& genotype) const {
+    std::uint32_t id[2] = { tag, Config::nBit };
+    Key k = internal::fnv1a(genotype.data(), genotype.length(),
+        internal::fnv1a(id, sizeof(id)));
+    return k == 0 ? 1 : k;
+  }
+
+  bool find(Key k, double& error, std::uint64_t& fp) {
+    __atomic_fetch_add(&lookups, 1, __ATOMIC_RELAXED);
+    for(size_t ix = k & mask, cnt = 0; cnt < maxProbe;
+        ix = (ix + 1) & mask, cnt++) {
+      Slot& s = slot(ix);
+      Key sk = __atomic_load_n(&s.key, __ATOMIC_ACQUIRE);
+      if(sk == 0)
+        return false;
+      if(sk != k)
+        continue;
+      std::uint64_t v = __atomic_load_n(&s.value, __ATOMIC_ACQUIRE);
+      if(v == 0)
+        return false; // being written by someone else
+      error = decode(v);
+      fp = s.fp;
+      __atomic_fetch_add(&hits, 1, __ATOMIC_RELAXED);
+      return true;
+    }
+    return false;
+  }
+
+  void insert(Key k, double error, std::uint64_t fp) {
+    put(k, error, fp, tag, Config::nBit);
+  }
+
+  /* Calls fun(const Entry&) for all complete entries. Used by cachetool. */
+  template<class Fun>
+  void forEach(Fun fun) const {
+    for(size_t ix = 0; ix <= mask; ix++) {
+      const Slot& s = slot(ix);
+      std::uint64_t v = __atomic_load_n(&s.value, __ATOMIC_ACQUIRE);
+      if(s.key == 0 || v == 0)
+        continue;
+      fun(Entry{s.key, decode(v), s.fp, s.tag, s.nBit});
+    }
+  }
+
+  // Copies an entry verbatim, including its problem tag. Used by cachetool.
+  bool insert(const Entry& e) {
+    return put(e.key, e.error, e.fp, e.tag, e.nBit);
+  }
+
+  const Header& info() const {
+    return header();
+  }
+
+  // Copies the table of problem names from another cache.
+  void copyNames(const DiskCache& other) {
+    map.lock();
+    for(unsigned i = 0; i < other.info().nNames; i++)
+      registerName(other.info().names[i]);
+    map.unlock();
+  }
+
+  friend std::ostream& operator<< (std::ostream& os, const DiskCache& c) {
+    return os << c.hits << " hits in " << c.lookups << " lookups, "
+      << c.header().count << " entries";
+  }
+
+  static constexpr size_t defCapacity = 1 << 22;
+
+private:
+
+  static const char* magic() {
+    return "QGAcache";
+  }
+
+  static constexpr std::uint32_t version = 1;
+  static constexpr size_t maxProbe = 64;
+  static constexpr double maxLoad = 0.75;
+
+  // Returns false if the table is full
+  bool put(Key k, double error, std::uint64_t fp,
+      std::uint32_t tag_, std::uint32_t nBit) {
+    if(__atomic_load_n(&header().count, __ATOMIC_RELAXED)
+        >= maxLoad * header().capacity)
+      return false;
+    for(size_t ix = k & mask, cnt = 0; cnt < maxProbe;
+        ix = (ix + 1) & mask, cnt++) {
+      Slot& s = slot(ix);
+      Key expected = 0;
+      if(!__atomic_compare_exchange_n(&s.key, &expected, k, false,
+            __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+        if(expected == k)
+          return true; // already present
+        else
+          continue;
+      }
+      s.fp = fp;
+      s.tag = tag_;
+      s.nBit = nBit;
+      __atomic_store_n(&s.value, encode(error), __ATOMIC_RELEASE);
+      __atomic_fetch_add(&header().count, 1, __ATOMIC_RELAXED);
+      return true;
+    }
+    return false;
+  }
+
+  Header& header() const {
+    return *static_cast<Header*>(map.data());
+  }
+
+  // Whether the header is all zeros
+  bool fresh() const {
+    const char* p = static_cast<const char*>(map.data());
+    return std::all_of(p, p + sizeof(Header), [](char c) { return c == 0; });
+  }
+
+  Slot& slot(size_t ix) const {
+    return reinterpret_cast<Slot*>(static_cast<char*>(map.data())
+        + sizeof(Header))[ix];
+  }
+
+  // Must be called with the file locked
+  void registerName(const std::string& name) {
+    if(name.empty())
+      return;
+    std::uint32_t t = internal::fnv1a(name.data(), name.length());
+    Header& h = header();
+    for(unsigned i = 0; i < h.nNames; i++)
+      if(h.tags[i] == t)
+        return;
+    if(h.nNames == maxNames)
+      return;
+    h.tags[h.nNames] = t;
+    std::strncpy(h.names[h.nNames], name.c_str(), sizeof(h.names[0]) - 1);
+    h.nNames++;
+  }
+
+  static std::uint64_t encode(double error) {
+    std::uint64_t v;
+    std::memcpy(&v, &error, sizeof(v));
+    return ~v;
+  }
+
+  static double decode(std::uint64_t v) {
+    v = ~v;
+    double error;
+    std::memcpy(&error, &v, sizeof(v));
+    return error;
+  }
+
+  MappedFile map{};
+  std::uint32_t tag = 0;
+  size_t mask = 0;
+  // Statistics of this process
+  size_t lookups = 0;
+  size_t hits = 0;
+
+}; // class DiskCache
+
+} // namespace QGA
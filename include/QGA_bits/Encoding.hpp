@@ -0,0 +1,161 @@
+namespace QGA {
+
+namespace internal {
+
+/* A gene in the compact binary form of GenotypeWriter and GenotypeReader,
+ * filled by GateBase::encode() and read back by the static decode() of each
+ * gate type. Qubits are 0-based; which fields are used depends on the type:
+ * op selects one of the gates of a list or holds the parity of a power, ctrl
+ * holds the other qubits (the controls, or the second qubit of a swap) as in
+ * Backend::Controls::mask(), and angles are in radians. */
+
+struct GeneCode {
+
+  static constexpr unsigned maxAngles = 3;
+
+  unsigned type;         // index of the gate type in the Gene
+  unsigned op;
+  unsigned tgt;
+  std::uint64_t ctrl;
+  unsigned nAngles;
+  double angles[maxAngles];
+
+  /* Whether tgt and ctrl are valid qubits for Config::nBit, ctrl does not
+   * contain tgt, and there are exactly n angles. */
+  bool fits(unsigned n) const {
+    std::uint64_t all = Config::nBit < 64
+      ? (std::uint64_t(1) << Config::nBit) - 1 : ~std::uint64_t(0);
+    return tgt < Config::nBit && !(ctrl & ~all) && !(ctrl >> tgt & 1)
+      && nAngles == n;
+  }
+
+  // Equality of all the fields in use, the angles bit by bit
+  friend bool operator== (const GeneCode& a, const GeneCode& b) {
+    return a.type == b.type && a.op == b.op && a.tgt == b.tgt
+      && a.ctrl == b.ctrl && a.nAngles == b.nAngles
+      && std::memcmp(a.angles, b.angles, a.nAngles * sizeof(double)) == 0;
+  }
+
+}; // struct GeneCode
+
+
+/* A scanner for the text form of genes, used by the read() functions of the
+ * gates. Each function either consumes what it matches and returns true, or
+ * returns false, after which the gene is rejected as a whole, so the input
+ * is read in one pass without backtracking. */
+
+class Scanner {
+
+public:
+
+  Scanner(const std::string& s): p(s.data()), end(s.data() + s.size()) { }
+
+  bool done() const {
+    return p == end;
+  }
+
+  // The literal str
+  bool lit(const char* str) {
+    const char* q = p;
+    for( ; *str; str++, q++)
+      if(q == end || *q != *str)
+        return false;
+    p = q;
+    return true;
+  }
+
+  /* The longest name of the list (a vector of structs with a member name)
+   * which the input starts with. Gives its index in which. */
+  template<class List>
+  bool name(const List& list, size_t& which) {
+    size_t best = 0, len = 0;
+    for(size_t i = 0; i < list.size(); i++) {
+      const std::string& n = list[i].name;
+      if(n.size() > len && size_t(end - p) >= n.size()
+          && std::equal(n.begin(), n.end(), p)) {
+        best = i;
+        len = n.size();
+      }
+    }
+    if(len == 0)
+      return false;
+    which = best;
+    p += len;
+    return true;
+  }
+
+  // A qubit given by a single digit from 1 to Config::nBit
+  bool qubit(unsigned& q) {
+    if(p == end || *p < '1' || *p > '9' || unsigned(*p - '1') >= Config::nBit)
+      return false;
+    q = *p++ - '1';
+    return true;
+  }
+
+  // A nonempty sequence of digits
+  bool number(unsigned long& n) {
+    if(p == end || !std::isdigit((unsigned char)*p))
+      return false;
+    n = 0;
+    while(p != end && std::isdigit((unsigned char)*p))
+      n = 10 * n + (*p++ - '0');
+    return true;
+  }
+
+  /* Qubits given by a nonempty sequence of digits, as a mask like in
+   * Backend::Controls::mask(). Digits which are out of range or equal to
+   * skip are ignored. */
+  bool qubits(std::uint64_t& mask, unsigned skip) {
+    if(p == end || !std::isdigit((unsigned char)*p))
+      return false;
+    mask = 0;
+    for( ; p != end && std::isdigit((unsigned char)*p); p++) {
+      unsigned q = *p - '1';
+      if(q < Config::nBit && q != skip)
+        mask |= std::uint64_t(1) << q;
+    }
+    return true;
+  }
+
+  // Control qubits in brackets if present, see qubits()
+  bool controls(std::uint64_t& mask, unsigned tgt) {
+    mask = 0;
+    if(!lit("["))
+      return true;
+    return qubits(mask, tgt) && lit("]");
+  }
+
+  // An angle given as a multiple of π, optionally followed by the symbol
+  bool angle(double& a) {
+    const char* q = p;
+    while(q != end && (std::isdigit((unsigned char)*q) || *q == '.'
+          || *q == '-' || *q == '+' || *q == 'e' || *q == 'E'))
+      q++;
+    if(q == p)
+      return false;
+    char* stop;
+    // the number is followed by another character or the terminating 0
+    a = std::strtod(p, &stop);
+    if(stop != q)
+      return false;
+    a *= Const::pi;
+    p = q;
+    lit("π");
+    return true;
+  }
+
+  // Skips the rest of the input
+  void rest() {
+    p = end;
+  }
+
+private:
+
+  const char* p;
+  const char* end;
+
+}; // class Scanner
+
+} // namespace internal
+
+} // namespace QGA
@@ -0,0 +1,139 @@
+namespace QGA {
+
+/* A functional fingerprint of a circuit: a hash of its action on a few fixed
+ * pseudo-random input states. Each output state is first rid of its global
+ * phase (referring to its largest component) and then quantized to a coarse
+ * grid, so two genotypes implementing the same unitary produce the same
+ * fingerprint even if their gates differ. Rounding near the grid boundaries
+ * can occasionally split two equal circuits but this only costs a missed
+ * duplicate. Conversely, different functions can share a fingerprint, so
+ * a match needs to be confirmed, see CandidateBase::sameFunc(). A value of 0
+ * is reserved for "not computed". */
+
+class Fingerprint {
+
+public:
+
+  using Value = std::uint64_t;
+
+  /* A single probe consists of an input state and an auxiliary random number
+   * below 2^nBit which problems can use for any other circuit-wide input
+   * (e.g., the mark of an oracle). */
+  struct Probe {
+    Backend::State psi;
+    unsigned aux;
+  };
+
+  /* Prepares Config::fpProbes probes for the current value of Config::nBit.
+   * Needs to be called before any compute() and whenever nBit changes. The
+   * seed is fixed so that fingerprints are reproducible between runs. */
+  static void init() {
+    std::mt19937 rng{Config::nBit};
+    std::normal_distribution<> dNorm{};
+    unsigned dim = 1 << Config::nBit;
+    std::uniform_int_distribution<unsigned> dAux{0, dim - 1};
+    std::vector<Probe>& ps = probes();
+    ps.clear();
+    for(unsigned k = 0; k < Config::fpProbes; k++) {
+      Backend::State psi{};
+      double norm = 0;
+      for(unsigned i = 0; i < dim; i++) {
+        Backend::cxd z{dNorm(rng), dNorm(rng)};
+        psi[i] = z;
+        norm += std::norm(z);
+      }
+      norm = std::sqrt(norm);
+      for(unsigned i = 0; i < dim; i++)
+        psi[i] /= norm;
+      ps.push_back({std::move(psi), dAux(rng)});
+    }
+  }
+
+  /* Computes the fingerprint, calling sim(const Probe&) -> Backend::State to
+   * obtain the circuit's output for each probe. */
+  template<class Sim>
+  static Value compute(Sim sim) {
+    Value hash = internal::fnv1a(&Config::nBit, sizeof(Config::nBit));
+    unsigned dim = 1 << Config::nBit;
+    for(const Probe& p : probes()) {
+      const Backend::State out = sim(p);
+      // Reference the phase to the largest amplitude
+      Backend::cxd ref{};
+      for(unsigned i = 0; i < dim; i++)
+        if(std::abs(out[i]) > std::abs(ref))
+          ref = out[i];
+      Backend::cxd phase = std::abs(ref) > 0
+        ? std::conj(ref) / std::abs(ref) : 1;
+      for(unsigned i = 0; i < dim; i++) {
+        Backend::cxd z = out[i] * phase;
+        long q[2] = { std::lround(z.real() * grid),
+                      std::lround(z.imag() * grid) };
+        hash = internal::fnv1a(q, sizeof(q), hash);
+      }
+    }
+    return hash == 0 ? 1 : hash;
+  }
+
+private:
+
+  static std::vector<Probe>& probes() {
+    static std::vector<Probe> ps{};
+    return ps;
+  }
+
+  static constexpr double grid = 1 << 12;
+
+}; // class Fingerprint
+
+
+namespace internal {
+
+/* A thread-safe map from hashes of genotypes to known results of the
+ * functional part of fitness, see CandidateBase::memoError(). The table is
+ * simply dropped when it grows beyond maxSize entries. */
+
+template<typename T>
+class FunctionalCache {
+
+public:
+
+  bool find(std::uint64_t key, T& value) {
+    bool found;
+    #pragma omp critical(QGA_FunctionalCache)
+    {
+      auto it = map.find(key);
+      found = it != map.end();
+      if(found)
+        value = it->second;
+      lookups++;
+      hits += found;
+    }
+    return found;
+  }
+
+  void insert(std::uint64_t key, const T& value) {
+    #pragma omp critical(QGA_FunctionalCache)
+    {
+      if(map.size() >= maxSize)
+        map.clear();
+      map.emplace(key, value);
+    }
+  }
+
+  friend std::ostream& operator<< (std::ostream& os, const FunctionalCache& c) {
+    return os << c.hits << " hits in " << c.lookups << " lookups";
+  }
+
+private:
+
+  static constexpr size_t maxSize = 1 << 20;
+
+  std::unordered_map<std::uint64_t, T> map{};
+  size_t lookups = 0;
+  size_t hits = 0;
+
+}; // class FunctionalCache<T>
+
+} // namespace internal
+
+} // namespace QGA
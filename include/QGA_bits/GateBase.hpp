@@ -16,6 +16,9 @@ namespace internal {
 template<class ContextParm, class... Gates>
 class GateBase :
   protected internal::CastInject<GateBase<ContextParm, Gates...>, Gates...>
+#ifdef GENE_ARENA
+  , public std::enable_shared_from_this<GateBase<ContextParm, Gates...>>
+#endif
 {
 
 protected:
@@ -39,9 +42,44 @@ public:
     return 0;
   }
 
+  // return the qubits this gate acts on, including controls (default: all)
+  virtual std::vector<unsigned> qubits() const {
+    std::vector<unsigned> ret(Config::nBit);
+    for(unsigned q = 0; q < Config::nBit; q++)
+      ret[q] = q;
+    return ret;
+  }
+
+  /* Fills the flat form of this gate for internal::PackedCircuit if it has
+   * one (default: no) and returns whether it did. */
+  virtual bool pack(internal::PackedGate&) const {
+    return false;
+  }
+
+  /* Fills the compact binary form of this gate, see internal::GeneCode, if
+   * it has one (default: no) and returns whether it did. The type field is
+   * set by the caller. */
+  virtual bool encode(internal::GeneCode&) const {
+    return false;
+  }
+
+  /* Continuous parameters (angles) of this gate, used for gradient-based
+   * optimization in CandidateBase::optimize(). Gates having any need to
+   * implement all the following three functions. */
+  virtual std::vector<double> params() const {
+    return {};
+  }
+
+  // apply the derivative of this gate w.r.t. params()[ix] to a state vector
+  virtual Backend::State applyDiff(const Backend::State&, unsigned,
+      const Context* = nullptr) const {
+    throw std::logic_error("applyDiff() called on a gate without parameters");
+  }
+
   /* The following functions pass a std::shared_ptr (SP) pointing to this
    * along with this. If a gate allows a given operation, it should return a
-   * new SP created using std::make_shared<OwnClass>. If it does not, it
+   * new SP created using std::make_shared<OwnClass>, or a shared instance
+   * if the class is interned (see Interned). If it does not, it
    * should return the parameter self so it can be reused just with its
    * reference count upped instead of creating a new copy. The default
    * implementation does precisely that. */
@@ -62,6 +100,19 @@ public:
 
   virtual Pointer swapQubits(const Pointer&, unsigned, unsigned) const = 0;
 
+  // return a copy with params() replaced by the given values
+  virtual Pointer withParams(const Pointer& self, const double*) const {
+    return self;
+  }
+
+  /* Returns the gate(s) replacing this one in a circuit one qubit wider. This
+   * is called after Config::nBit has been increased. Gates acting on given
+   * qubits do this according to their Lift parameter, the default is for
+   * gates which don't refer to any. */
+  virtual std::vector<Pointer> lift(const Pointer& self) const {
+    return {self};
+  }
+
   /* The cast() function is a light-weight version of dynamic_cast: knowing
    * all the derived subclasses *a priori*, we can define a virtual function
    * for each that returns a nullptr if the type does not match and returns
@@ -106,16 +157,23 @@ public:
 
   virtual ~GateBase() { }
 
+#ifdef GENE_ARENA
+  // Whether internal::GateArena holds a reference to this gate
+  mutable std::atomic<bool> adopted{false};
+#endif
+
 private:
 
   virtual std::ostream& write(std::ostream&) const = 0;
 
-  /* Finally, the derived classes need to provide the following static method:
+  /* Finally, the derived classes need to provide the following static methods:
    *
    *   static Pointer read(const std::string& s);
+   *   static Pointer decode(const internal::GeneCode& code);
    *
-   * This can not be enforced or default-implemented by an abstract base
-   * class. A no-op can return Pointer{}. */
+   * reading the output of write() and the code filled by encode(),
+   * respectively. This can not be enforced or default-implemented by an
+   * abstract base class. A no-op can return Pointer{}. */
 
 }; // virtual class GateBase<Context, Gates...>
 
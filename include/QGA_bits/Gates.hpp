@@ -45,6 +45,41 @@ inline Backend::Gate phase(double a) {
   };
 }
 
+
+#ifdef ANGLE_BITS
+
+// fn at all the values of Angle, indexed by Angle::raw(), built on first use
+template<Backend::Gate(*fn)(double)>
+const std::vector<Backend::Gate>& table() {
+  static const std::vector<Backend::Gate> tab = [] {
+    std::vector<Backend::Gate> ret{};
+    ret.reserve(Angle::steps);
+    for(std::uint32_t v = 0; v < Angle::steps; v++)
+      ret.push_back(fn(Angle::fromRaw(v)));
+    return ret;
+  }();
+  return tab;
+}
+
+#endif // ANGLE_BITS
+
+/* The matrix of a parametric gate at angle a. With quantized angles, the
+ * functions above are looked up in their tables. */
+
+inline Backend::Gate gate(Backend::Gate(*fn)(double), Angle a) {
+#ifdef ANGLE_BITS
+  if(fn == xrot)
+    return table<xrot>()[a.raw()];
+  if(fn == yrot)
+    return table<yrot>()[a.raw()];
+  if(fn == zrot)
+    return table<zrot>()[a.raw()];
+  if(fn == phase)
+    return table<phase>()[a.raw()];
+#endif
+  return fn(a);
+}
+
 } // namespace internal
 } // namespace Gates
 } // namespace QGA
@@ -55,3 +90,4 @@ inline Backend::Gate phase(double a) {
 #include "gates/CNOT.hpp"
 #include "gates/SU2.hpp"
 #include "gates/SWAP.hpp"
+#include "gates/Module.hpp"
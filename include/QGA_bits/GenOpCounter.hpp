@@ -19,7 +19,7 @@ public:
 
   friend std::ostream& operator<< (std::ostream& os, const GenOpCounter& trk) {
     /* Find the longest GenOp name */
-    auto max = std::max_element(ops.begin(), ops.end(),
+    auto max = std::max_element(ops.begin(), ops.begin() + count,
         [](const GenOp& a, const GenOp& b) {
           return a.name.length() < b.name.length();
         });
@@ -29,7 +29,7 @@ public:
     auto flags_ = os.flags(std::ios_base::left);
 
     /* List all op names and probabilities */
-    for(size_t ix = 0; ix < ops.size(); ix++)
+    for(size_t ix = 0; ix < count; ix++)
       os << ops[ix].name
          << std::setw(maxw + 3 - ops[ix].name.length()) << ':'
          << trk.hits[ix] << '\n';
@@ -41,6 +41,7 @@ public:
 private:
 
   static constexpr auto& ops = CandidateFactory::ops;
+  static constexpr size_t count = CandidateFactory::opCount();
   std::array<size_t, ops.size()> hits{};
 
 }; // class GenOpCounter
@@ -9,6 +9,159 @@ class Chooser;
 template<class, class...>
 class Reader;
 
+template<class, class...>
+class Decoder;
+
+template<class, class...>
+struct Parametric;
+
+
+#ifdef GENE_ARENA
+
+/* Ownership of gates in GENE_ARENA mode. Each gate a Gene refers to is kept
+ * here by a shared pointer, in a list belonging to the thread which created
+ * the Gene, so that Genes only need to hold plain pointers. Copying a
+ * genotype then does not touch the reference counts, which are otherwise
+ * shared among all threads. sweep() releases the gates no longer in use and
+ * must be called while no other thread is creating Genes. */
+
+template<class T>
+class GateArena {
+
+  using Pointer = std::shared_ptr<const T>;
+
+  struct List {
+
+    std::vector<Pointer> gates;
+
+    List(): gates() {
+      std::lock_guard<std::mutex> lock{mutex()};
+      lists().push_back(this);
+    }
+
+    // gates of a finishing thread may still be in use elsewhere
+    ~List() {
+      std::lock_guard<std::mutex> lock{mutex()};
+      auto& all = lists();
+      all.erase(std::find(all.begin(), all.end(), this));
+      orphans().insert(orphans().end(), gates.begin(), gates.end());
+    }
+
+  }; // struct List
+
+public:
+
+  /* Takes a reference to the gate unless the arena already holds one (e.g.
+   * when it was returned unchanged by a genetic operation or is interned),
+   * so owned gates only cost a load of T::adopted here. */
+  static void adopt(Pointer&& ptr) {
+    if(ptr->adopted.load(std::memory_order_relaxed)
+        || ptr->adopted.exchange(true))
+      return;
+    static thread_local List local{};
+    local.gates.push_back(std::move(ptr));
+  }
+
+  /* Keeps one reference to each gate in live and drops all others. Gates
+   * still referenced from outside the arena (e.g. interned gates) are only
+   * released by the arena. */
+  static void sweep(const std::unordered_set<const T*>& live) {
+    std::lock_guard<std::mutex> lock{mutex()};
+    std::unordered_set<const T*> kept{};
+    auto drop = [&](const Pointer& ptr) -> bool {
+      if(live.count(ptr.get()))
+        return !kept.insert(ptr.get()).second;
+      ptr->adopted.store(false, std::memory_order_relaxed);
+      return true;
+    };
+    for(List* list : lists()) {
+      auto& gates = list->gates;
+      gates.erase(std::remove_if(gates.begin(), gates.end(), drop),
+          gates.end());
+    }
+    auto& rest = orphans();
+    rest.erase(std::remove_if(rest.begin(), rest.end(), drop), rest.end());
+  }
+
+private:
+
+  static std::mutex& mutex() {
+    static std::mutex m{};
+    return m;
+  }
+
+  static std::vector<List*>& lists() {
+    static std::vector<List*> all{};
+    return all;
+  }
+
+  static std::vector<Pointer>& orphans() {
+    static std::vector<Pointer> rest{};
+    return rest;
+  }
+
+}; // class GateArena<T>
+
+
+/* A plain pointer to a gate owned by GateArena, standing in for a shared
+ * pointer in Gene. The shared pointer is recovered when needed using
+ * shared_from_this(). */
+
+template<class T>
+class ArenaPtr {
+
+  using Pointer = std::shared_ptr<const T>;
+
+public:
+
+  ArenaPtr(): raw(nullptr) { }
+
+  ArenaPtr(const Pointer& ptr): ArenaPtr(Pointer{ptr}) { }
+
+  ArenaPtr(Pointer&& ptr): raw(ptr.get()) {
+    if(raw)
+      GateArena<T>::adopt(std::move(ptr));
+  }
+
+  // the gate is only adopted if this did not refer to it yet
+  ArenaPtr& operator=(Pointer&& ptr) {
+    if(ptr.get() != raw)
+      *this = ArenaPtr{std::move(ptr)};
+    return *this;
+  }
+
+  operator Pointer() const {
+    return raw ? raw->shared_from_this() : Pointer{};
+  }
+
+  const T* get() const {
+    return raw;
+  }
+
+  const T* operator->() const {
+    return raw;
+  }
+
+  const T& operator*() const {
+    return *raw;
+  }
+
+  bool operator==(const ArenaPtr& other) const {
+    return raw == other.raw;
+  }
+
+  friend void swap(ArenaPtr& a, ArenaPtr& b) {
+    std::swap(a.raw, b.raw);
+  }
+
+private:
+
+  const T* raw;
+
+}; // class ArenaPtr<T>
+
+#endif // GENE_ARENA
+
 
 /* The Gene type ready for use with a CandidateBase.
  *
@@ -17,25 +170,42 @@ class Reader;
  *
  * Implements a static getRandom() function which randomly picks from the given
  * Gates, along with several shortcuts to functions of the GateBase.  Other
- * functions like applyTo() or type() are redirected using a ->. */
+ * functions like applyTo() or type() are redirected using a ->.
+ *
+ * With GENE_ARENA, a plain pointer is held instead and the gates are owned
+ * by a GateArena, see sweep(). */
 
 template<class Context, class... Gates>
-class Gene : GateBase<Context, Gates...>::Pointer {
+class Gene :
+#ifdef GENE_ARENA
+  ArenaPtr<GateBase<Context, Gates...>>
+#else
+  GateBase<Context, Gates...>::Pointer
+#endif
+{
 
   using GBase = GateBase<Context, Gates...>;
   using Pointer = typename GBase::Pointer;
   using Indexer = typename GBase::Indexer;
+#ifdef GENE_ARENA
+  using Storage = ArenaPtr<GBase>;
+#else
+  using Storage = Pointer;
+#endif
 
 public:
 
   template<class Context_>
   using WithContext = Gene<Context_, Gates...>;
 
+  using ContextType = Context;
+  using PointerType = Pointer;
+
   Gene() = default; // Needed in CandidateBase::read()
 
-  Gene(const Pointer& ptr): Pointer(ptr) { }
+  Gene(const Pointer& ptr): Storage(ptr) { }
 
-  Gene(Pointer&& ptr): Pointer(std::move(ptr)) { }
+  Gene(Pointer&& ptr): Storage(std::move(ptr)) { }
 
   static Gene getRandom() {
     return {internal::Chooser<
@@ -44,11 +214,11 @@ public:
   }
 
   const GBase* operator->() const {
-    return Pointer::operator->();
+    return Storage::operator->();
   }
 
   const GBase& operator*() const {
-    return Pointer::operator*();
+    return Storage::operator*();
   }
 
   friend std::ostream& operator<<(std::ostream& os, const Gene& g) {
@@ -59,15 +229,39 @@ public:
     std::string gene{};
     if(!(is >> gene))
       return is;
+    if(!read(gene, g))
+      is.setstate(std::ios::failbit);
+    return is;
+  }
+
+  // Reads a single gene as written by operator<<, returns false on failure
+  static bool read(const std::string& s, Gene& g) {
     Pointer ptr = internal::Reader<
       typename Gates::template Template<GBase>...
-    >::read(gene);
-    if(!ptr) {
-      is.setstate(std::ios::failbit);
-      return is;
-    }
+    >::read(s);
+    if(!ptr)
+      return false;
     g = {ptr};
-    return is;
+    return true;
+  }
+
+  /* Fills the compact binary form of this gene, see internal::GeneCode.
+   * Returns false if the gate has none (e.g., a module). */
+  bool encode(internal::GeneCode& code) const {
+    code = internal::GeneCode{};
+    code.type = pointer()->type();
+    return pointer()->encode(code);
+  }
+
+  // The inverse of encode(), returns false if code is not valid
+  static bool decode(const internal::GeneCode& code, Gene& g) {
+    Pointer ptr = internal::Decoder<
+      typename Gates::template Template<GBase>...
+    >::decode(code, code.type);
+    if(!ptr)
+      return false;
+    g = {ptr};
+    return true;
   }
 
   /* These helper functions simplify the call pattern of the pointer-passing
@@ -88,10 +282,19 @@ public:
     pointer() = pointer()->simplify(pointer());
   }
 
+  void setParams(const double* values) {
+    pointer() = pointer()->withParams(pointer(), values);
+  }
+
   void swapQubits(unsigned s1, unsigned s2) {
     pointer() = pointer()->swapQubits(pointer(), s1, s2);
   }
 
+  std::vector<Gene> lift() const {
+    std::vector<Pointer> ptrs = pointer()->lift(pointer());
+    return {ptrs.begin(), ptrs.end()};
+  }
+
   bool merge(const Gene& other) {
     if(pointer()->isTrivial()) {
       // op1 = identity: consume and return other
@@ -117,7 +320,8 @@ public:
 
   /* Two genes are equal iff they point to the same object. This is used in
    * CandidateFactory to check if a genotype has changed at all during a
-   * mutation (if not, the parent is returned). */
+   * mutation (if not, the parent is returned). Interned gates (see
+   * Interned) are equal iff they are the same gate. */
   bool operator==(const Gene& other) const {
     return pointer() == other.pointer();
   }
@@ -131,14 +335,58 @@ public:
     return GBase::template gateType<Gate>();
   }
 
+  // The class implementing Gate in this Gene
+  template<class Gate>
+  using GateClass = typename Gate::template Template<GBase>;
+
+  // Whether any of the gates has continuous parameters, see GBase::params()
+  static constexpr bool parametric() {
+    return internal::Parametric<GBase,
+      typename Gates::template Template<GBase>...>::value;
+  }
+
+  // The shared pointer, for gates built of other gates
+#ifdef GENE_ARENA
+  Pointer get() const {
+    return pointer();
+  }
+
+  /* Releases the gates which are not used by any genotype in the given
+   * containers of candidates, which together must contain all candidates
+   * in existence. */
+  template<class... Containers>
+  static void sweep(const Containers&... conts) {
+    std::unordered_set<const GBase*> live{};
+    collect(live, conts...);
+    GateArena<GBase>::sweep(live);
+  }
+#else
+  const Pointer& get() const {
+    return pointer();
+  }
+#endif
+
 private:
 
-  Pointer& pointer() {
-    return static_cast<Pointer&>(*this);
+#ifdef GENE_ARENA
+  static void collect(std::unordered_set<const GBase*>&) { }
+
+  template<class Container, class... Rest>
+  static void collect(std::unordered_set<const GBase*>& live,
+      const Container& cands, const Rest&... rest) {
+    for(const auto& c : cands)
+      for(const Gene& g : c.genotype())
+        live.insert(g.pointer().get());
+    collect(live, rest...);
   }
+#endif
 
-  const Pointer& pointer() const {
-    return static_cast<const Pointer&>(*this);
+  Storage& pointer() {
+    return static_cast<Storage&>(*this);
+  }
+
+  const Storage& pointer() const {
+    return static_cast<const Storage&>(*this);
   }
 
 }; // class Gene<Context, Gates...>
@@ -163,7 +411,8 @@ namespace internal {
  * i = 0: std::make_shared<B>()
  * i = 0: std::make_shared<C>()
  * etc. The classes A, B, C, ... need to be default-constructible and
- * convertible to the class referred to by the pointer P. */
+ * convertible to the class referred to by the pointer P. A class providing
+ * a static random() returning P is asked for that instead. */
 
 template<class Pointer, class Head, class... Tail>
 class Chooser<Pointer, Head, Tail...> : Chooser<Pointer, Tail...> {
@@ -180,11 +429,24 @@ protected:
 
   static Pointer getRandom(unsigned index) {
     if(index == 0)
-      return std::make_shared<Head>();
+      return create<Head>(0);
     else
       return Chooser<Pointer, Tail...>::getRandom(index - 1);
   }
 
+private:
+
+  // Uses T::random() if T has one (e.g. interned gates, see Interned)
+  template<class T>
+  static auto create(int) -> decltype(T::random()) {
+    return T::random();
+  }
+
+  template<class T>
+  static Pointer create(long) {
+    return std::make_shared<T>();
+  }
+
 }; // class Chooser<Pointer, Head, Tail...>
 
 template<class Pointer>
@@ -208,7 +470,8 @@ class Reader {
 
 public:
 
-  static auto read(std::string input) -> decltype(Head::read(input)) {
+  static auto read(const std::string& input)
+      -> decltype(Head::read(input)) {
     if(auto ret = Head::read(input))
       return ret;
     else
@@ -222,12 +485,60 @@ class Reader<Last> {
 
 public:
 
-  static auto read(std::string input) -> decltype(Last::read(input)) {
+  static auto read(const std::string& input)
+      -> decltype(Last::read(input)) {
     return Last::read(input);
   }
 
 }; // class Reader<Last>
 
+
+/* Called as Decoder<A, B, C, ...>::decode(code, i), returns the result of
+ * A::decode(code) for i = 0, B::decode(code) for i = 1, etc., and a null
+ * pointer if i is out of range. */
+
+template<class Head, class... Tail>
+class Decoder {
+
+public:
+
+  static auto decode(const GeneCode& code, unsigned index)
+      -> decltype(Head::decode(code)) {
+    if(index == 0)
+      return Head::decode(code);
+    else
+      return Decoder<Tail...>::decode(code, index - 1);
+  }
+
+}; // class Decoder<Head, Tail...>
+
+template<class Last>
+class Decoder<Last> {
+
+public:
+
+  static auto decode(const GeneCode& code, unsigned index)
+      -> decltype(Last::decode(code)) {
+    if(index == 0)
+      return Last::decode(code);
+    else
+      return {};
+  }
+
+}; // class Decoder<Last>
+
+
+/* Parametric<Base, A, B, C, ...>::value tells whether any of the classes
+ * A, B, C, ... derived from Base overrides Base::params(). */
+
+template<class Base, class... Gates>
+struct Parametric : std::false_type { };
+
+template<class Base, class Head, class... Tail>
+struct Parametric<Base, Head, Tail...> : std::integral_constant<bool,
+    !std::is_same<decltype(&Head::params), decltype(&Base::params)>::value
+    || Parametric<Base, Tail...>::value> { };
+
 } // namespace internal
 
 } // namespace QGA
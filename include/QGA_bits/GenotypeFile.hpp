@@ -0,0 +1,246 @@
+namespace QGA {
+
+namespace internal {
+
+/* Files of genotypes, used to seed the initial population and to save the
+ * final front (see CandidateBase::load() and save()). The compact binary
+ * form is
+ *
+ *   char magic[8];          "QGAGENES"
+ *   uint32_t nBit;          at most Config::nBit when read
+ *   uint32_t reserved;      0
+ *
+ * followed by the genotypes, each a varint count and count genes of
+ *
+ *   uint8_t type, op, tgt, nAngles;
+ *   varint ctrl;
+ *   double angles[nAngles];
+ *
+ * (see GeneCode) in native byte order, the varints as unsigned LEB128. Gate
+ * types are given by their index in the Gene, so a file can only be read by
+ * problems using the same Gene. Any other file is read as text, one genotype
+ * per line as written by CandidateBase::operator<<, skipping empty lines. */
+
+namespace GenotypeFile {
+
+  constexpr size_t headSize = 16;
+
+  inline const char* magic() {
+    return "QGAGENES";
+  }
+
+} // namespace GenotypeFile
+
+
+/* Writes the binary form to a stream, one genotype at a time. */
+
+template<class Gene>
+class GenotypeWriter {
+
+public:
+
+  GenotypeWriter(std::ostream& os_): os(os_), buf() {
+    std::uint32_t head[2] = {Config::nBit, 0};
+    os.write(GenotypeFile::magic(), 8);
+    os.write(reinterpret_cast<const char*>(head), sizeof head);
+  }
+
+  /* Appends a genotype. Returns false if one of its genes has no compact
+   * form, in which case nothing is written. */
+  template<class Genotype>
+  bool write(const Genotype& gt) {
+    buf.clear();
+    varint(gt.size());
+    GeneCode code;
+    for(const Gene& g : gt) {
+      if(!g.encode(code) || code.type > 255 || code.op > 255)
+        return false;
+      check(g, code);
+      buf.push_back(char(code.type));
+      buf.push_back(char(code.op));
+      buf.push_back(char(code.tgt));
+      buf.push_back(char(code.nAngles));
+      varint(code.ctrl);
+      buf.append(reinterpret_cast<const char*>(code.angles),
+          code.nAngles * sizeof(double));
+    }
+    os.write(buf.data(), buf.size());
+    return true;
+  }
+
+private:
+
+  /* Each gene written must come back as itself: decode() must accept its
+   * code and give a gene with the same code and the same text. Anything
+   * else is an error in the encode() or decode() of the gate type. */
+  static void check(const Gene& g, const GeneCode& code) {
+    Gene back{};
+    GeneCode again;
+    if(!Gene::decode(code, back) || !back.encode(again) || !(again == code)
+        || text(back) != text(g))
+      throw std::logic_error("Gene " + text(g) + " can't be encoded");
+  }
+
+  static std::string text(const Gene& g) {
+    std::ostringstream os{};
+    os << std::setprecision(17) << g;
+    return os.str();
+  }
+
+  void varint(std::uint64_t x) {
+    for( ; x >= 0x80; x >>= 7)
+      buf.push_back(char((x & 0x7F) | 0x80));
+    buf.push_back(char(x));
+  }
+
+  std::ostream& os;
+  std::string buf;
+
+}; // class GenotypeWriter<Gene>
+
+
+/* Reads the binary form from memory, see MappedFile. Errors throw
+ * std::runtime_error with the name of the file and the offset. */
+
+template<class Gene>
+class GenotypeReader {
+
+public:
+
+  // Whether the data starts with the binary header
+  static bool detect(const char* data, size_t size) {
+    return size >= 8 && std::memcmp(data, GenotypeFile::magic(), 8) == 0;
+  }
+
+  GenotypeReader(const char* data, size_t size, const std::string& name_):
+      begin(data), p(data), end(data + size), name(name_) {
+    std::uint32_t head[2];
+    if(!detect(data, size) || size < GenotypeFile::headSize)
+      fail("not a genotype file");
+    std::memcpy(head, data + 8, sizeof head);
+    if(head[0] > Config::nBit)
+      throw std::runtime_error(name + ": genotypes are for "
+          + std::to_string(head[0]) + " qubits");
+    p += GenotypeFile::headSize;
+  }
+
+  // Reads the next genotype into gt, returns false at the end of the data
+  bool read(std::vector<Gene>& gt) {
+    gt.clear();
+    if(p == end)
+      return false;
+    std::uint64_t count = varint();
+    // each gene takes at least 5 bytes
+    if(count > size_t(end - p) / 5)
+      fail("truncated");
+    gt.reserve(count);
+    GeneCode code{};
+    Gene g{};
+    for(std::uint64_t i = 0; i < count; i++) {
+      const char* at = p;
+      need(4);
+      code.type = byte();
+      code.op = byte();
+      code.tgt = byte();
+      code.nAngles = byte();
+      code.ctrl = varint();
+      if(code.nAngles > GeneCode::maxAngles)
+        fail("invalid gene", at);
+      need(code.nAngles * sizeof(double));
+      std::memcpy(code.angles, p, code.nAngles * sizeof(double));
+      p += code.nAngles * sizeof(double);
+      if(!Gene::decode(code, g))
+        fail("invalid gene", at);
+      gt.push_back(std::move(g));
+    }
+    return true;
+  }
+
+private:
+
+  [[noreturn]] void fail(const char* what, const char* at = nullptr) {
+    throw std::runtime_error(name + ": " + what + " at offset "
+        + std::to_string((at ? at : p) - begin));
+  }
+
+  void need(size_t n) {
+    if(size_t(end - p) < n)
+      fail("truncated");
+  }
+
+  unsigned byte() {
+    return static_cast<unsigned char>(*p++);
+  }
+
+  std::uint64_t varint() {
+    std::uint64_t x = 0;
+    for(unsigned shift = 0; ; shift += 7) {
+      need(1);
+      if(shift > 63)
+        fail("invalid varint");
+      unsigned b = byte();
+      x |= std::uint64_t(b & 0x7F) << shift;
+      if(!(b & 0x80))
+        return x;
+    }
+  }
+
+  const char* begin;
+  const char* p;
+  const char* end;
+  const std::string& name;
+
+}; // class GenotypeReader<Gene>
+
+
+/* Reads the text form from memory line by line. Errors throw
+ * std::runtime_error with the name of the file and the line number. */
+
+template<class Gene>
+class GenotypeTextReader {
+
+public:
+
+  GenotypeTextReader(const char* data, size_t size, const std::string& name_):
+      p(data), end(data + size), line(0), name(name_), token() { }
+
+  // Reads the next nonempty line into gt, returns false at the end
+  bool read(std::vector<Gene>& gt) {
+    gt.clear();
+    while(p != end && gt.empty()) {
+      const char* eol = std::find(p, end, '\n');
+      line++;
+      Gene g{};
+      while(p != eol) {
+        while(p != eol && std::isspace(static_cast<unsigned char>(*p)))
+          p++;
+        const char* q = p;
+        while(q != eol && !std::isspace(static_cast<unsigned char>(*q)))
+          q++;
+        if(q == p)
+          break;
+        token.assign(p, q);
+        if(!Gene::read(token, g))
+          throw std::runtime_error(name + ":" + std::to_string(line)
+              + ": can't read gene " + token);
+        gt.push_back(std::move(g));
+        p = q;
+      }
+      p = eol == end ? end : eol + 1;
+    }
+    return !gt.empty();
+  }
+
+private:
+
+  const char* p;
+  const char* end;
+  size_t line;
+  const std::string& name;
+  std::string token;
+
+}; // class GenotypeTextReader<Gene>
+
+} // namespace internal
+
+} // namespace QGA
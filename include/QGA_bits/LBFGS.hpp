@@ -0,0 +1,124 @@
+namespace QGA {
+
+namespace internal {
+
+/* A compact limited-memory BFGS minimizer with a backtracking line search,
+ * used for fine-tuning the angles of a circuit (see CandidateBase::optimize).
+ * The objective is called as
+ *
+ *   double fun(const std::vector<double>& x, std::vector<double>& grad)
+ *
+ * returning the value at x and filling in the gradient. */
+
+class LBFGS {
+
+public:
+
+  LBFGS(unsigned memory_ = 5): memory(memory_) { }
+
+  // Updates x in place, returns the function value at the final x
+  template<class Fun>
+  double minimize(std::vector<double>& x, Fun fun, unsigned maxIter) {
+    size_t n = x.size();
+    std::vector<double> g(n), d(n), xNew(n), gNew(n);
+    double f = fun(x, g);
+    std::deque<Pair> hist{};
+    for(unsigned iter = 0; iter < maxIter; iter++) {
+      // Two-loop recursion: d = -H g
+      d = g;
+      std::vector<double> alpha(hist.size());
+      for(size_t k = hist.size(); k-- > 0; ) {
+        alpha[k] = hist[k].rho * dot(hist[k].s, d);
+        axpy(-alpha[k], hist[k].y, d);
+      }
+      if(!hist.empty()) {
+        const Pair& last = hist.back();
+        scale(dot(last.s, last.y) / dot(last.y, last.y), d);
+      }
+      for(size_t k = 0; k < hist.size(); k++) {
+        double beta = hist[k].rho * dot(hist[k].y, d);
+        axpy(alpha[k] - beta, hist[k].s, d);
+      }
+      scale(-1, d);
+      double slope = dot(g, d);
+      if(slope >= 0) {
+        // Not a descent direction: forget the history
+        hist.clear();
+        d = g;
+        scale(-1, d);
+        slope = dot(g, d);
+      }
+      if(slope > -eps)
+        break;
+      // Backtrack until the Armijo condition holds
+      double step = 1, fNew = f;
+      bool found = false;
+      for(unsigned ls = 0; ls < maxBacktrack; ls++, step /= 2) {
+        xNew = x;
+        axpy(step, d, xNew);
+        fNew = fun(xNew, gNew);
+        if(fNew <= f + armijo * step * slope) {
+          found = true;
+          break;
+        }
+      }
+      if(!found)
+        break;
+      Pair p{std::vector<double>(n), std::vector<double>(n), 0};
+      for(size_t i = 0; i < n; i++) {
+        p.s[i] = xNew[i] - x[i];
+        p.y[i] = gNew[i] - g[i];
+      }
+      double sy = dot(p.s, p.y);
+      if(sy > eps) {
+        p.rho = 1 / sy;
+        hist.push_back(std::move(p));
+        if(hist.size() > memory)
+          hist.pop_front();
+      }
+      x.swap(xNew);
+      g.swap(gNew);
+      f = fNew;
+    }
+    return f;
+  }
+
+private:
+
+  struct Pair {
+    std::vector<double> s;  // change of x
+    std::vector<double> y;  // change of gradient
+    double rho;             // 1 / (s·y)
+  };
+
+  static double dot(const std::vector<double>& a,
+      const std::vector<double>& b) {
+    double ret = 0;
+    for(size_t i = 0; i < a.size(); i++)
+      ret += a[i] * b[i];
+    return ret;
+  }
+
+  // y += a x
+  static void axpy(double a, const std::vector<double>& x,
+      std::vector<double>& y) {
+    for(size_t i = 0; i < x.size(); i++)
+      y[i] += a * x[i];
+  }
+
+  static void scale(double a, std::vector<double>& x) {
+    for(auto& v : x)
+      v *= a;
+  }
+
+  static constexpr double eps = 1e-12;
+  static constexpr double armijo = 1e-4;
+  static constexpr unsigned maxBacktrack = 10;
+
+  unsigned memory;
+
+}; // class LBFGS
+
+} // namespace internal
+
+} // namespace QGA
@@ -0,0 +1,171 @@
+namespace QGA {
+
+namespace internal {
+
+/* Monte Carlo simulation of a circuit under Pauli noise, used by
+ * CandidateBase::noisyError(). After each gate, every qubit it acts on is
+ * hit by a random X, Y or Z with probability Config::noiseDepol1 (gates on
+ * one qubit) or Config::noiseDepol2 (gates on more qubits), or else by Z
+ * with probability Config::noiseDephase.
+ *
+ * All the trajectories are sampled first, as lists of noise events, and then
+ * simulated together as a trie: trajectories sharing a prefix of events
+ * share its simulation, and those without any more events share the rest of
+ * the circuit. The work then grows with the number of distinct noise events
+ * rather than with the number of trajectories times the circuit length.
+ * The events are also sampled by skipping over the quiet gates. The
+ * channels are taken from Problem::channelCount() and channel(), see
+ * CandidateBase. The random numbers come from a generator of its own,
+ * seeded by the caller, so that the estimate can be reproduced. */
+
+template<class Genotype, class Problem>
+class Trajectories {
+
+  using Gene = typename Genotype::value_type;
+  using Channel = typename Problem::Channel;
+
+public:
+
+  Trajectories(const Genotype& gt_, std::uint64_t seed):
+      gt(gt_), pc(gt_), qs(), cum(), rng(seed) {
+    double total = 0;
+    for(const auto& g : gt) {
+      qs.push_back(g->qubits());
+      // -log of the probability that no qubit of this gate is hit
+      total -= qs.back().size() * std::log1p(-rate(qs.back()));
+      cum.push_back(total);
+    }
+  }
+
+  /* Mean error 1 - |<target|out>|^2 over count trajectories, each starting
+   * from a random channel. */
+  double run(unsigned count) {
+    size_t nc = Problem::channelCount();
+    if(nc == 0 || count == 0)
+      return 0;
+    std::uniform_int_distribution<size_t> dChan{0, nc - 1};
+    std::vector<std::vector<Events>> trajs(nc);
+    for(unsigned i = 0; i < count; i++)
+      trajs[dChan(rng)].push_back(sample());
+    double total = 0;
+    for(size_t ic = 0; ic < nc; ic++) {
+      std::vector<Events>& ts = trajs[ic];
+      if(ts.empty())
+        continue;
+      std::sort(ts.begin(), ts.end());
+      const Channel& c = Problem::channel(ic);
+      total += descend(c, ts, 0, ts.size(), 0, c.psi, 0);
+    }
+    return total / count;
+  }
+
+private:
+
+  struct Event {
+    size_t pos;      // after which gate
+    unsigned qubit;
+    unsigned pauli;  // 1 = X, 2 = Y, 3 = Z
+
+    friend bool operator< (const Event& a, const Event& b) {
+      return a.pos < b.pos || (a.pos == b.pos && (a.qubit < b.qubit
+            || (a.qubit == b.qubit && a.pauli < b.pauli)));
+    }
+
+    friend bool operator== (const Event& a, const Event& b) {
+      return a.pos == b.pos && a.qubit == b.qubit && a.pauli == b.pauli;
+    }
+  };
+
+  using Events = std::vector<Event>;
+
+  // Probability of an error on each qubit of a gate acting on qubits
+  static double rate(const std::vector<unsigned>& qubits) {
+    double pDepol = qubits.size() > 1 ? Config::noiseDepol2
+      : Config::noiseDepol1;
+    double p = pDepol + (1 - pDepol) * Config::noiseDephase;
+    return std::min(p, maxRate);
+  }
+
+  /* The gates after which a noise event happens form a Poisson-like
+   * process with the cumulative intensity cum, so the next one is found by
+   * a binary search for an exponentially distributed increment. */
+  Events sample() {
+    Events ret{};
+    std::exponential_distribution<> dExp{};
+    std::uniform_real_distribution<> dUni{};
+    std::uniform_int_distribution<unsigned> dPauli{1, 3};
+    double t = 0;
+    for(;;) {
+      t += dExp(rng);
+      size_t pos = std::upper_bound(cum.begin(), cum.end(), t) - cum.begin();
+      if(pos >= gt.size())
+        return ret;
+      t = cum[pos];
+      // At least one qubit of this gate is hit
+      const std::vector<unsigned>& qubits = qs[pos];
+      double p = rate(qubits);
+      double pDepol = qubits.size() > 1 ? Config::noiseDepol2
+        : Config::noiseDepol1;
+      size_t first = ret.size();
+      while(ret.size() == first)
+        for(unsigned q : qubits)
+          if(dUni(rng) < p)
+            ret.push_back({pos, q, dUni(rng) * p < pDepol
+                ? dPauli(rng) : 3});
+      std::sort(ret.begin() + first, ret.end());
+    }
+  }
+
+  void advance(Backend::State& psi, size_t from, size_t to,
+      const Channel& c) const {
+    pc.apply(psi, from, to, c.ctx);
+  }
+
+  static Backend::State pauli(const Backend::State& psi, const Event& e) {
+    static const Backend::Gate* ops[] = {nullptr,
+      &Backend::X, &Backend::Y, &Backend::Z};
+    return psi.apply_ctrl(*ops[e.pauli], Backend::Controls{}, e.qubit);
+  }
+
+  /* Sum of errors of trajectories ts[lo] to ts[hi - 1], which share their
+   * first depth events. psi is the state after the first pos gates and
+   * these events. Sorting puts the trajectories with no further event
+   * first and groups the rest by their next event, in order of position. */
+  double descend(const Channel& c, const std::vector<Events>& ts,
+      size_t lo, size_t hi, size_t depth, Backend::State psi,
+      size_t pos) const {
+    size_t done = lo;
+    while(done < hi && ts[done].size() == depth)
+      done++;
+    double sum = 0;
+    for(size_t i = done; i < hi; ) {
+      const Event& e = ts[i][depth];
+      size_t j = i + 1;
+      while(j < hi && ts[j][depth] == e)
+        j++;
+      advance(psi, pos, e.pos + 1, c);
+      pos = e.pos + 1;
+      sum += descend(c, ts, i, j, depth + 1, pauli(psi, e), pos);
+      i = j;
+    }
+    if(done > lo) {
+      advance(psi, pos, gt.size(), c);
+      double error = 1 - std::norm(Backend::State::overlap(c.target, psi));
+      sum += (done - lo) * std::max(error, 0.0);
+    }
+    return sum;
+  }
+
+  static constexpr double maxRate = 0.5;
+
+  const Genotype& gt;
+  PackedCircuit<Gene> pc;
+  std::vector<std::vector<unsigned>> qs;
+  std::vector<double> cum;
+  std::mt19937_64 rng;
+
+}; // class Trajectories<Genotype, Problem>
+
+} // namespace internal
+
+} // namespace QGA
@@ -0,0 +1,116 @@
+namespace QGA {
+
+namespace internal {
+
+/* A gate in the flat form used by PackedCircuit. The common gates are a 2×2
+ * matrix applied to one qubit when all of a set of control qubits are 1, or
+ * a swap of two qubits. Qubits are given as bit masks of the basis state
+ * index, see Backend::State::apply_ctrl_mask(). Other gates are OTHER and
+ * have to be applied through GateBase::applyTo(). */
+
+struct PackedGate {
+
+  enum Kind : unsigned char {
+    OTHER,
+    IDENTITY,
+    CTRL,
+    SWAP
+  };
+
+  Kind kind;
+  std::size_t mask1;     // CTRL: target, SWAP: one qubit, OTHER: index
+  std::size_t mask2;     // CTRL: all controls, SWAP: the other qubit
+  Backend::cxd mat[4];   // CTRL: row-major
+
+  static std::size_t qubit(unsigned q) {
+    return std::size_t(1) << (Config::nBit - 1 - q);
+  }
+
+  static PackedGate identity() {
+    return {IDENTITY, 0, 0, {}};
+  }
+
+  static PackedGate ctrl(const Backend::Gate& mat, const Backend::Controls& ixs,
+      unsigned tgt) {
+    PackedGate ret{CTRL, qubit(tgt), 0, {mat(0, 0), mat(0, 1), mat(1, 0),
+      mat(1, 1)}};
+    for(std::uint64_t bits = ixs.mask(), c = 0; bits; bits >>= 1, c++)
+      if(bits & 1)
+        ret.mask2 |= qubit(c);
+    return ret;
+  }
+
+  static PackedGate swap(unsigned s1, unsigned s2) {
+    return {SWAP, qubit(s1), qubit(s2), {}};
+  }
+
+}; // struct PackedGate
+
+
+/* A genotype compiled into a contiguous array of PackedGates, so that the
+ * circuit can be simulated in place, without a virtual call, a new State and
+ * the indirections to the Gate and Controls of each gate. Gates whose
+ * GateBase::pack() returns false are kept by pointer and applied as usual.
+ * The packed form is only valid while Config::nBit stays the same. */
+
+template<class Gene>
+class PackedCircuit {
+
+  using Pointer = typename Gene::PointerType;
+  using Ctx = typename Gene::ContextType;
+
+public:
+
+  template<class Genotype>
+  PackedCircuit(const Genotype& gt): ops(), others() {
+    ops.reserve(gt.size());
+    for(const auto& g : gt) {
+      PackedGate p{};
+      if(!g->pack(p)) {
+        p.kind = PackedGate::OTHER;
+        p.mask1 = others.size();
+        others.push_back(g.get());
+      }
+      ops.push_back(p);
+    }
+  }
+
+  size_t size() const {
+    return ops.size();
+  }
+
+  // Applies gates from to to - 1 to psi
+  void apply(Backend::State& psi, size_t from, size_t to,
+      const Ctx* ctx = nullptr) const {
+    for(size_t k = from; k < to; k++) {
+      const PackedGate& p = ops[k];
+      switch(p.kind) {
+        case PackedGate::CTRL:
+          psi.apply_ctrl_mask(p.mat, p.mask2, p.mask1);
+          break;
+        case PackedGate::SWAP:
+          psi.swap_mask(p.mask1, p.mask2);
+          break;
+        case PackedGate::OTHER:
+          psi = others[p.mask1]->applyTo(psi, ctx);
+          break;
+        case PackedGate::IDENTITY:
+          break;
+      }
+    }
+  }
+
+  void apply(Backend::State& psi, const Ctx* ctx = nullptr) const {
+    apply(psi, 0, ops.size(), ctx);
+  }
+
+private:
+
+  std::vector<PackedGate> ops;
+  std::vector<Pointer> others;
+
+}; // class PackedCircuit<Gene>
+
+} // namespace internal
+
+} // namespace QGA
@@ -0,0 +1,335 @@
+namespace QGA {
+
+namespace internal {
+
+/* A persistent sequence, used for genotypes (see CandidateBase::Genotype).
+ * The elements are kept in immutable chunks of at most chunkSize elements,
+ * shared by all ropes which contain them, and a rope is a list of pieces
+ * (ranges within chunks). Copying a rope or taking a slice of it copies the
+ * list of pieces but none of the elements, so a child made of large parts
+ * of its parents shares their storage. New elements go into new chunks,
+ * see Builder, and set() replaces the single piece affected.
+ *
+ * The iterators are random-access, but advancing one by more than a step
+ * and operator[] cost a binary search over the pieces. A rope which
+ * becomes too fragmented is copied into fresh chunks. */
+
+template<class T>
+class Rope {
+
+  static constexpr size_t chunkSize = 32;
+
+  using Chunk = std::vector<T, ArenaAllocator<T>>;
+  using ChunkPtr = std::shared_ptr<const Chunk>;
+
+  struct Piece {
+    ChunkPtr chunk;
+    size_t first;
+    size_t count;
+    size_t end;     // position in the rope after this piece
+  };
+
+  using Pieces = std::vector<Piece, ArenaAllocator<Piece>>;
+
+public:
+
+  class const_iterator {
+
+  public:
+
+    using iterator_category = std::random_access_iterator_tag;
+    using value_type = T;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const T*;
+    using reference = const T&;
+
+    const_iterator(): rope(nullptr), ip(0), off(0), pos(0) { }
+
+    reference operator*() const {
+      const Piece& p = rope->pieces[ip];
+      return (*p.chunk)[p.first + off];
+    }
+
+    pointer operator->() const {
+      return &**this;
+    }
+
+    reference operator[](difference_type n) const {
+      return *(*this + n);
+    }
+
+    const_iterator& operator++() {
+      pos++;
+      if(++off == rope->pieces[ip].count) {
+        ip++;
+        off = 0;
+      }
+      return *this;
+    }
+
+    const_iterator operator++(int) {
+      const_iterator ret{*this};
+      ++*this;
+      return ret;
+    }
+
+    const_iterator& operator--() {
+      pos--;
+      if(off-- == 0) {
+        ip--;
+        off = rope->pieces[ip].count - 1;
+      }
+      return *this;
+    }
+
+    const_iterator operator--(int) {
+      const_iterator ret{*this};
+      --*this;
+      return ret;
+    }
+
+    const_iterator& operator+=(difference_type n) {
+      return *this = rope->at(pos + n);
+    }
+
+    const_iterator& operator-=(difference_type n) {
+      return *this = rope->at(pos - n);
+    }
+
+    friend const_iterator operator+(const_iterator it, difference_type n) {
+      return it += n;
+    }
+
+    friend const_iterator operator+(difference_type n, const_iterator it) {
+      return it += n;
+    }
+
+    friend const_iterator operator-(const_iterator it, difference_type n) {
+      return it -= n;
+    }
+
+    friend difference_type operator-(const const_iterator& lhs,
+        const const_iterator& rhs) {
+      return difference_type(lhs.pos) - difference_type(rhs.pos);
+    }
+
+    friend bool operator==(const const_iterator& lhs,
+        const const_iterator& rhs) {
+      return lhs.pos == rhs.pos;
+    }
+
+    friend bool operator!=(const const_iterator& lhs,
+        const const_iterator& rhs) {
+      return lhs.pos != rhs.pos;
+    }
+
+    friend bool operator<(const const_iterator& lhs,
+        const const_iterator& rhs) {
+      return lhs.pos < rhs.pos;
+    }
+
+    friend bool operator>(const const_iterator& lhs,
+        const const_iterator& rhs) {
+      return lhs.pos > rhs.pos;
+    }
+
+    friend bool operator<=(const const_iterator& lhs,
+        const const_iterator& rhs) {
+      return lhs.pos <= rhs.pos;
+    }
+
+    friend bool operator>=(const const_iterator& lhs,
+        const const_iterator& rhs) {
+      return lhs.pos >= rhs.pos;
+    }
+
+  private:
+
+    const_iterator(const Rope* rope_, size_t ip_, size_t off_, size_t pos_):
+      rope(rope_), ip(ip_), off(off_), pos(pos_) { }
+
+    const Rope* rope;
+    size_t ip;    // index of the piece
+    size_t off;   // offset within the piece
+    size_t pos;   // position in the rope
+
+    friend class Rope;
+
+  }; // class Rope<T>::const_iterator
+
+  using iterator = const_iterator;
+  using value_type = T;
+  using size_type = size_t;
+
+
+  /* Assembles a new rope from slices of existing ones and new elements.
+   * Adjacent new elements are stored together in new chunks. */
+
+  class Builder {
+
+  public:
+
+    Builder(): pieces(), open(), size_(0) { }
+
+    size_t size() const {
+      return size_;
+    }
+
+    void push_back(T elm) {
+      if(!open) {
+        open = std::allocate_shared<Chunk>(ArenaAllocator<Chunk>{});
+        // the arena never reuses the space left behind by reallocation
+        open->reserve(chunkSize);
+      }
+      open->push_back(std::move(elm));
+      size_++;
+      if(open->size() == chunkSize)
+        seal();
+    }
+
+    // Appends elements from to to - 1 of src
+    void append(const Rope& src, size_t from, size_t to) {
+      if(from >= to)
+        return;
+      seal();
+      size_ += to - from;
+      const_iterator it = src.at(from);
+      size_t ip = it.ip, off = it.off;
+      while(from < to) {
+        const Piece& p = src.pieces[ip];
+        size_t cnt = std::min(p.count - off, to - from);
+        add(p.chunk, p.first + off, cnt);
+        from += cnt;
+        ip++;
+        off = 0;
+      }
+    }
+
+    void append(const Rope& src) {
+      append(src, 0, src.size());
+    }
+
+    template<class InputIt>
+    void append(InputIt first, InputIt last) {
+      for( ; first != last; ++first)
+        push_back(*first);
+    }
+
+    Rope build() {
+      seal();
+      Rope ret{std::move(pieces), size_};
+      pieces = Pieces{};
+      size_ = 0;
+      if(ret.fragmented())
+        return Rope{ret.begin(), ret.end()};
+      return ret;
+    }
+
+  private:
+
+    void seal() {
+      if(!open)
+        return;
+      size_t cnt = open->size();
+      add(std::move(open), 0, cnt);
+      open.reset();
+    }
+
+    // Adds a piece, extending the last one if it continues in its chunk
+    void add(ChunkPtr chunk, size_t first, size_t count) {
+      if(!pieces.empty()) {
+        Piece& last = pieces.back();
+        if(last.chunk == chunk && last.first + last.count == first) {
+          last.count += count;
+          last.end += count;
+          return;
+        }
+      }
+      size_t end = (pieces.empty() ? 0 : pieces.back().end) + count;
+      pieces.push_back({std::move(chunk), first, count, end});
+    }
+
+    Pieces pieces;
+    std::shared_ptr<Chunk> open;  // not shared with any rope yet
+    size_t size_;
+
+  }; // class Rope<T>::Builder
+
+
+  Rope(): pieces(), size_(0) { }
+
+  template<class InputIt>
+  Rope(InputIt first, InputIt last): Rope() {
+    Builder b{};
+    b.append(first, last);
+    *this = b.build();
+  }
+
+  size_t size() const {
+    return size_;
+  }
+
+  bool empty() const {
+    return size_ == 0;
+  }
+
+  const_iterator begin() const {
+    return {this, 0, 0, 0};
+  }
+
+  const_iterator end() const {
+    return {this, pieces.size(), 0, size_};
+  }
+
+  const T& operator[](size_t pos) const {
+    return *at(pos);
+  }
+
+  const T& front() const {
+    return *begin();
+  }
+
+  const T& back() const {
+    return *--end();
+  }
+
+  /* Replaces the element at pos. Only the piece containing it is copied,
+   * into a new chunk. */
+  void set(size_t pos, T elm) {
+    const_iterator it = at(pos);
+    Piece& p = pieces[it.ip];
+    auto chunk = std::allocate_shared<Chunk>(ArenaAllocator<Chunk>{},
+        p.chunk->begin() + p.first, p.chunk->begin() + p.first + p.count);
+    (*chunk)[it.off] = std::move(elm);
+    p.chunk = std::move(chunk);
+    p.first = 0;
+  }
+
+private:
+
+  Rope(Pieces&& pieces_, size_t size__): pieces(std::move(pieces_)),
+    size_(size__) { }
+
+  // An iterator pointing at pos, which may equal size()
+  const_iterator at(size_t pos) const {
+    if(pos >= size_)
+      return end();
+    auto it = std::upper_bound(pieces.begin(), pieces.end(), pos,
+        [](size_t p, const Piece& piece) { return p < piece.end; });
+    size_t ip = it - pieces.begin();
+    return {this, ip, pos - (it->end - it->count), pos};
+  }
+
+  // Whether there are many more pieces than needed for the elements
+  bool fragmented() const {
+    return pieces.size() > 8 + 4 * (size_ / chunkSize);
+  }
+
+  Pieces pieces;
+  size_t size_;
+
+}; // class Rope<T>
+
+} // namespace internal
+
+} // namespace QGA
@@ -42,6 +42,85 @@ inline double rationalize_angle(double a) {
 }
 
 
+#ifdef ANGLE_BITS
+
+static_assert(ANGLE_BITS >= 2 && ANGLE_BITS <= 20,
+    "ANGLE_BITS must be between 2 and 20");
+
+/* Quantized angles, enabled by compiling with -DANGLE_BITS=k: multiples of
+ * 2π/2^k stored as k-bit integers. Sums and inverses are exact modular
+ * arithmetic, equal angles compare equal, and the parametric gates can be
+ * looked up in precomputed tables (see func::gate()). Like rationalize_angle,
+ * this identifies angles differing by 2π. Converts to double in (-π, π]. */
+
+class Angle {
+
+public:
+
+  static constexpr unsigned bits = ANGLE_BITS;
+  static constexpr std::uint32_t steps = std::uint32_t(1) << bits;
+  static constexpr std::uint32_t mask = steps - 1;
+
+  Angle(): v(0) { }
+
+  // rounds a to the nearest representable angle
+  explicit Angle(double a):
+    v(std::uint32_t(std::llround(a / (2.0 * Const::pi) * steps)) & mask) { }
+
+  static Angle fromRaw(std::uint32_t raw) {
+    Angle ret{};
+    ret.v = raw & mask;
+    return ret;
+  }
+
+  std::uint32_t raw() const {
+    return v;
+  }
+
+  operator double() const {
+    return (v > steps / 2 ? double(v) - steps : double(v))
+      * 2.0 * Const::pi / steps;
+  }
+
+  Angle operator- () const {
+    return fromRaw(steps - v);
+  }
+
+  friend Angle operator+ (Angle a, Angle b) {
+    return fromRaw(a.v + b.v);
+  }
+
+  friend bool operator== (Angle a, Angle b) {
+    return a.v == b.v;
+  }
+
+private:
+
+  std::uint32_t v;
+
+}; // class Angle
+
+/* The counterpart of rationalize_angle for quantized angles: the angle is
+ * rounded to a random number of significant bits, between 1 (a multiple of
+ * π) and all of them (unchanged). */
+
+inline Angle rationalize_angle(Angle a) {
+  unsigned keep = std::uniform_int_distribution<unsigned>{1, Angle::bits}
+    (gen::rng);
+  unsigned cut = Angle::bits - keep;
+  if(cut == 0)
+    return a;
+  std::uint32_t half = std::uint32_t(1) << (cut - 1);
+  return Angle::fromRaw((a.raw() + half) >> cut << cut);
+}
+
+#else
+
+using Angle = double;
+
+#endif // ANGLE_BITS
+
+
 /* An enum for possible settings for controls_distribution below */
 
 enum class Controls {
@@ -51,9 +130,21 @@ enum class Controls {
   ANY
 };
 
-/* A distribution generating bit strings of length nBit where the probability
- * of 1 in each position is given by pTrue. The bit at position nSkip is left
- * off. */
+/* An enum for the ways a gate can be carried over to a circuit one qubit
+ * wider, see GateBase::lift(). The new qubit is the last one unless stated
+ * otherwise. */
+
+enum class Lift {
+  KEEP,    // act on the same qubits, leaving the new one idle
+  SHIFT,   // act on the following qubits, the new one being the first
+  EXTEND,  // as KEEP, adding the new qubit as a control if allowed
+  COPY     // as KEEP, followed by a copy acting on the new qubit in place of
+           // the formerly last one
+};
+
+/* A distribution generating sets of control qubits out of nBit where the
+ * probability of each qubit being included is given by pTrue. The qubit
+ * iSkip is left off. */
 
 template<Controls cc>
 class controls_distribution {
@@ -69,25 +160,26 @@ public:
     }
 
   template<class URNG>
-  std::vector<bool> operator() (URNG& rng) {
-    std::vector<bool> bits(nBit, false);
+  Backend::Controls operator() (URNG& rng) {
+    std::uint64_t bits = 0;
 
     if(cc == Controls::ANY || cc == Controls::LEAST1) {
       std::bernoulli_distribution dist(pTrue);
       for(unsigned i = 0; i < nBit; i++) {
         if(i == iSkip)
           continue;
-        bits[i] = dist(rng);
+        if(dist(rng))
+          bits |= std::uint64_t(1) << i;
       }
     }
 
     if(cc == Controls::ONE || cc == Controls::LEAST1) {
       std::uniform_int_distribution<> dist(0, nBit - 2);
       unsigned res = dist(rng);
-      bits[res + (res >= iSkip)] = true;
+      bits |= std::uint64_t(1) << (res + (res >= iSkip));
     }
 
-    return bits;
+    return Backend::Controls{bits};
   }
 
 private:
@@ -99,6 +191,214 @@ private:
 }; // class controls_distribution<Controls>
 
 
+/* Helpers for implementing GateBase::lift() according to a Lift rule. These
+ * expect Config::nBit to be already increased. */
+
+template<Lift lr>
+unsigned lift_qubit(unsigned q) {
+  return lr == Lift::SHIFT ? q + 1 : q;
+}
+
+template<Lift lr, Controls cc>
+Backend::Controls lift_controls(const Backend::Controls& ixs) {
+  std::uint64_t bits = lr == Lift::SHIFT ? ixs.mask() << 1 : ixs.mask();
+  if(lr == Lift::EXTEND && (cc == Controls::ANY || cc == Controls::LEAST1))
+    bits |= std::uint64_t(1) << (Config::nBit - 1);
+  return Backend::Controls{bits};
+}
+
+// Takes the lifted gate and adds the copy for Lift::COPY if it differs
+template<Lift lr, class Pointer>
+std::vector<Pointer> lift_copy(const Pointer& gate) {
+  if(lr != Lift::COPY)
+    return {gate};
+  Pointer copy = gate->swapQubits(gate, Config::nBit - 2, Config::nBit - 1);
+  if(copy == gate || copy->sameType(*gate))
+    return {gate};
+  return {gate, copy};
+}
+
+
+/* Interning of gates which have a small finite number of distinct
+ * instances for the current Config::nBit, identified by keys below size.
+ * The first request for a key creates the instance using make() and later
+ * ones share it, so equal gates are the same object (see Gene::operator==)
+ * and most of the small allocations in the genetic operators are avoided.
+ * The slots are shared pointers accessed atomically: if two threads race to
+ * fill one, the instance stored first wins. A table is kept for each value
+ * of Config::nBit, allocated on first use. Types with too many keys are not
+ * interned. */
+
+template<class Gate, class Pointer>
+class Interned {
+
+public:
+
+  template<class Make>
+  static Pointer get(size_t key, size_t size, Make make) {
+    if(Config::nBit >= maxBits || size > maxSize)
+      return make();
+    Pointer& slot = table(size)[key];
+    Pointer ret = std::atomic_load(&slot);
+    if(ret)
+      return ret;
+    Pointer made = make();
+    if(std::atomic_compare_exchange_strong(&slot, &ret, made))
+      return made;
+    return ret;
+  }
+
+private:
+
+  static constexpr unsigned maxBits = 32;
+  static constexpr size_t maxSize = size_t(1) << 16;
+
+  static std::vector<Pointer>& table(size_t size) {
+    static std::vector<Pointer> tables[maxBits];
+    static std::once_flag once[maxBits];
+    unsigned n = Config::nBit;
+    std::call_once(once[n], [n, size]() { tables[n].resize(size); });
+    return tables[n];
+  }
+
+}; // class Interned<Gate, Pointer>
+
+
+/* Storage for genotypes, see ArenaAllocator. Each thread carves its
+ * allocations out of a chunk of its own by bumping a pointer. A chunk
+ * counts the allocations made in it which are still in use and is freed
+ * when this drops to zero after the thread has moved on to a new chunk.
+ * Candidates are mostly created and dropped a generation at a time, so
+ * the storage of a generation is released nearly wholesale. Large
+ * requests bypass the chunks. */
+
+class GenotypeArena {
+
+  struct Chunk {
+    std::atomic<size_t> live;  // allocations in use, plus one while current
+    size_t used;
+  };
+
+  // Each allocation is preceded by a pointer to its chunk (or nullptr)
+  static constexpr size_t align = alignof(std::max_align_t);
+  static constexpr size_t head = (sizeof(Chunk*) + align - 1) / align * align;
+  static constexpr size_t start = (sizeof(Chunk) + align - 1) / align * align;
+  static constexpr size_t chunkSize = size_t(1) << 16;
+
+  struct Current {
+
+    Chunk* chunk = nullptr;
+
+    ~Current() {
+      if(chunk)
+        release(chunk);
+    }
+
+  }; // struct Current
+
+public:
+
+  static void* allocate(size_t bytes) {
+    size_t need = head + (bytes + align - 1) / align * align;
+    char* mem;
+    Chunk* chunk;
+    if(need > (chunkSize - start) / 4) {
+      mem = static_cast<char*>(::operator new(need));
+      chunk = nullptr;
+    } else {
+      static thread_local Current cur{};
+      if(!cur.chunk || cur.chunk->used + need > chunkSize) {
+        if(cur.chunk)
+          release(cur.chunk);
+        cur.chunk = new(::operator new(chunkSize)) Chunk{{1}, start};
+      }
+      chunk = cur.chunk;
+      mem = reinterpret_cast<char*>(chunk) + chunk->used;
+      chunk->used += need;
+      chunk->live.fetch_add(1, std::memory_order_relaxed);
+    }
+    *reinterpret_cast<Chunk**>(mem) = chunk;
+    return mem + head;
+  }
+
+  static void deallocate(void* ptr) {
+    char* mem = static_cast<char*>(ptr) - head;
+    Chunk* chunk = *reinterpret_cast<Chunk**>(mem);
+    if(chunk)
+      release(chunk);
+    else
+      ::operator delete(mem);
+  }
+
+private:
+
+  static void release(Chunk* chunk) {
+    if(chunk->live.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+      chunk->~Chunk();
+      ::operator delete(chunk);
+    }
+  }
+
+}; // class GenotypeArena
+
+
+/* An allocator using GenotypeArena, for CandidateBase::Genotype. All
+ * instances are interchangeable. */
+
+template<class T>
+struct ArenaAllocator {
+
+  using value_type = T;
+
+  ArenaAllocator() = default;
+
+  template<class U>
+  ArenaAllocator(const ArenaAllocator<U>&) { }
+
+  T* allocate(size_t n) {
+    return static_cast<T*>(GenotypeArena::allocate(n * sizeof(T)));
+  }
+
+  void deallocate(T* ptr, size_t) {
+    GenotypeArena::deallocate(ptr);
+  }
+
+}; // struct ArenaAllocator<T>
+
+template<class T, class U>
+bool operator==(const ArenaAllocator<T>&, const ArenaAllocator<U>&) {
+  return true;
+}
+
+template<class T, class U>
+bool operator!=(const ArenaAllocator<T>&, const ArenaAllocator<U>&) {
+  return false;
+}
+
+
+/* Applies the derivative of a controlled gate, i.e., dmat (the derivative of
+ * the target gate) in the subspace where all the controls are set and zero
+ * elsewhere. */
+
+inline Backend::State apply_ctrl_diff(const Backend::State& psi,
+    const Backend::Gate& dmat, const Backend::Controls& ixs, unsigned tgt) {
+  Backend::State ret = psi.apply_ctrl(dmat, ixs, tgt);
+  if(ixs.size() == 0)
+    return ret;
+  Backend::State rest = psi.apply_ctrl({0, 0, 0, 0}, ixs, tgt);
+  for(size_t i = 0; i < (size_t(1) << Config::nBit); i++)
+    ret[i] -= rest[i];
+  return ret;
+}
+
+/* The derivative of any of the rotations func::xrot, yrot, zrot at angle a
+ * equals half of the same rotation at a + π. */
+
+inline Backend::Gate diff_rot(Backend::Gate(*fn)(double), double a) {
+  return Backend::Gate{0.5, 0, 0, 0.5} * fn(a + Const::pi);
+}
+
+
 /* Two related pre-initialized distributions: for generating initial values of
  * angle for parametric gates and for generating angle deviations for
  * continuous gate mutation. */
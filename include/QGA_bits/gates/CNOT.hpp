@@ -4,8 +4,8 @@ namespace Gates {
 
 namespace internal {
 
-template<Controls cc>
-class CNOT {
+template<Controls cc, Lift lr>
+struct CNOT {
 
 template<class GateBase>
 class CNOTTemp : public GateBase {
@@ -30,6 +30,14 @@ public:
 
   CNOTTemp(bool): tgt(), ixs(), odd(false) { }
 
+  // a random gate, interned
+  static Pointer random() {
+    unsigned tgt = std::uniform_int_distribution<unsigned>{0,
+      Config::nBit - 1}(gen::rng);
+    return make(tgt, controls_distribution<cc>{Config::nBit, tgt,
+        Config::pControl}(gen::rng));
+  }
+
   Backend::State applyTo(const Backend::State& psi, const Ctx*) const override {
     return odd ? psi.apply_ctrl(Backend::X, ixs, tgt) : psi;
   }
@@ -43,14 +51,32 @@ public:
     return ixs.size();
   }
 
+  std::vector<unsigned> qubits() const override {
+    std::vector<unsigned> ret = ixs.as_vector();
+    ret.push_back(tgt);
+    return ret;
+  }
+
+  bool pack(QGA::internal::PackedGate& p) const override {
+    p = odd ? QGA::internal::PackedGate::ctrl(Backend::X, ixs, tgt)
+      : QGA::internal::PackedGate::identity();
+    return true;
+  }
+
   Pointer swapQubits(const Pointer& self, unsigned s1, unsigned s2)
     const override
   {
-    return odd
-      ? std::make_shared<CNOTTemp>(
-          tgt == s1 ? s2 : tgt == s2 ? s1 : tgt,
-          Backend::Controls::swapQubits(ixs, s1, s2))
-      : self;
+    if(!odd)
+      return self;
+    return make(tgt == s1 ? s2 : tgt == s2 ? s1 : tgt,
+        Backend::Controls::swapQubits(ixs, s1, s2));
+  }
+
+  std::vector<Pointer> lift(const Pointer& self) const override {
+    if(!odd)
+      return {self};
+    return lift_copy<lr>(make(lift_qubit<lr>(tgt),
+          lift_controls<lr, cc>(ixs)));
   }
 
   unsigned type() const override {
@@ -67,14 +93,14 @@ public:
   }
 
   Pointer getAnother() const override {
-    return std::make_shared<CNOTTemp>();
+    return random();
   }
 
   Pointer merge(const GateBase& other) const override {
     if(!sameType(other))
       return {};
     const CNOTTemp* c = other.cast(this);
-    return std::make_shared<CNOTTemp>(tgt, ixs, odd ^ c->odd);
+    return make(tgt, ixs, odd ^ c->odd);
   }
 
   std::ostream& write(std::ostream& os) const override {
@@ -95,45 +121,68 @@ public:
       p.addControlledGate("X", tgt, ixs.as_vector());
   }
 
+  bool encode(QGA::internal::GeneCode& code) const override {
+    code.op = odd;
+    code.tgt = tgt;
+    code.ctrl = ixs.mask();
+    return true;
+  }
+
   static Pointer read(const std::string& s) {
-    regex::regex re{"(\\[Id\\])|NOT(\\d)(\\[(\\d+)\\])?"};
-    regex::matches ms{};
-    if(!re.match(s, ms))
+    QGA::internal::Scanner sc{s};
+    if(sc.lit("[Id]"))
+      return sc.done() ? make(0, {}, false) : Pointer{};
+    unsigned tgt;
+    std::uint64_t ctrl;
+    if(!(sc.lit("NOT") && sc.qubit(tgt) && sc.controls(ctrl, tgt)
+          && sc.done()))
       return {};
-    if(ms.matched(1))
-      return std::make_shared<CNOTTemp>(false);
-    unsigned tgt = ms.match(2)[0] - '1';
-    if(tgt >= Config::nBit)
+    return make(tgt, Backend::Controls{ctrl});
+  }
+
+  static Pointer decode(const QGA::internal::GeneCode& code) {
+    if(code.op > 1 || !code.fits(0))
       return {};
-    std::vector<bool> ctrl(Config::nBit, false);
-    if(ms.matched(3))
-      for(auto c : ms.match(4)) {
-        size_t pos = c - '1';
-        if(pos >= 0 && pos < Config::nBit && pos != tgt)
-          ctrl[c - '1'] = true;
-      }
-    return std::make_shared<CNOTTemp>(tgt, Backend::Controls{ctrl});
+    if(!code.op)
+      return code.tgt || code.ctrl ? Pointer{} : make(0, {}, false);
+    return make(code.tgt, Backend::Controls{code.ctrl});
   }
 
 private:
 
+  // The identity (odd = false) has one instance for all tgt and ctrl
+  static Pointer make(unsigned tgt, const Backend::Controls& ixs,
+      bool odd = true) {
+    size_t size = (size_t(Config::nBit) << Config::nBit) + 1;
+    if(!odd)
+      return Interned<CNOTTemp, Pointer>::get(size - 1, size,
+          []() -> Pointer { return std::make_shared<CNOTTemp>(false); });
+    return Interned<CNOTTemp, Pointer>::get(
+        size_t(tgt) << Config::nBit | ixs.mask(), size, [&]() -> Pointer {
+          return std::make_shared<CNOTTemp>(tgt, ixs);
+        });
+  }
+
   unsigned tgt;
   Backend::Controls ixs;
   bool odd;  // parity of the power
 
-}; // class CNOT<Controls>::CNOTTemp<GateBase>
+}; // class CNOT<Controls, Lift>::CNOTTemp<GateBase>
 
 template<class GateBase>
 using Template = CNOTTemp<GateBase>;
 
 template<Controls cc_>
-using WithControls = CNOT<cc_>;
+using WithControls = CNOT<cc_, lr>;
+
+template<Lift lr_>
+using WithLift = CNOT<cc, lr_>;
 
-}; // struct CNOT<Controls>
+}; // struct CNOT<Controls, Lift>
 
 } // namespace internal
 
-using CNOT = internal::CNOT<Controls::ONE>;
+using CNOT = internal::CNOT<Controls::ONE, Lift::KEEP>;
 
 } // namespace Gates
 
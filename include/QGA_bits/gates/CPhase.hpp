@@ -4,7 +4,7 @@ namespace Gates {
 
 namespace internal {
 
-template<Controls cc>
+template<Controls cc, Lift lr>
 struct CPhase {
 
 template<class GateBase>
@@ -20,29 +20,22 @@ public:
     tgt(std::uniform_int_distribution<unsigned>{0, Config::nBit - 1}
         (gen::rng)),
     angle(angle_distribution<>{}(gen::rng)),
-    ixs(), mat(func::phase(angle))
+    ixs(), mat(func::gate(func::phase, angle))
   {
     // distribution of controls
     controls_distribution<cc> dCtrl{Config::nBit, tgt, Config::pControl};
     // Convert P2[13] to P1[23]: mathematically identical and more easily
     // mergeable
-    std::vector<bool> ctrl = dCtrl(gen::rng);
-    ctrl[tgt] = true;
-    {
-      unsigned i;
-      for(i = 0; i < Config::nBit; i++)
-        if(ctrl[i])
-          break;
-      // i guaranteed to be < nBit now (at least one bit was set)
-      tgt = i;
-    }
-    ctrl[tgt] = false;
-    ixs = Backend::Controls{ctrl};
+    std::uint64_t bits = dCtrl(gen::rng).mask() | std::uint64_t(1) << tgt;
+    // the lowest qubit involved becomes the target (at least one bit is set)
+    tgt = lowest(bits);
+    ixs = Backend::Controls{bits & ~(std::uint64_t(1) << tgt)};
   }
 
   // construct using parameters
-  CPhaseTemp(unsigned tgt_, double angle_, const Backend::Controls& ixs_):
-      tgt(tgt_), angle(angle_), ixs(ixs_), mat(func::phase(angle)) { }
+  CPhaseTemp(unsigned tgt_, Angle angle_, const Backend::Controls& ixs_):
+      tgt(tgt_), angle(angle_), ixs(ixs_),
+      mat(func::gate(func::phase, angle)) { }
 
   Backend::State applyTo(const Backend::State& psi, const Ctx*) const override {
     return psi.apply_ctrl(mat, ixs, tgt);
@@ -56,6 +49,31 @@ public:
     return ixs.size();
   }
 
+  std::vector<unsigned> qubits() const override {
+    std::vector<unsigned> ret = ixs.as_vector();
+    ret.push_back(tgt);
+    return ret;
+  }
+
+  bool pack(QGA::internal::PackedGate& p) const override {
+    p = QGA::internal::PackedGate::ctrl(mat, ixs, tgt);
+    return true;
+  }
+
+  std::vector<double> params() const override {
+    return {angle};
+  }
+
+  Backend::State applyDiff(const Backend::State& psi, unsigned,
+      const Ctx*) const override {
+    return apply_ctrl_diff(psi,
+        {0, 0, 0, Const::i * std::exp(Const::i * double(angle))}, ixs, tgt);
+  }
+
+  Pointer withParams(const Pointer&, const double* values) const override {
+    return std::make_shared<CPhaseTemp>(tgt, Angle{values[0]}, ixs);
+  }
+
   Pointer getAnother() const override {
     return std::make_shared<CPhaseTemp>();
   }
@@ -66,7 +84,8 @@ public:
 
   Pointer mutate(const Pointer&) const override {
     angle_distribution<true> dAng{};
-    return std::make_shared<CPhaseTemp>(tgt, angle + dAng(gen::rng), ixs);
+    return std::make_shared<CPhaseTemp>(tgt, angle + Angle{dAng(gen::rng)},
+        ixs);
   }
 
   Pointer simplify(const Pointer&) const override {
@@ -76,24 +95,20 @@ public:
   Pointer swapQubits(const Pointer& self, unsigned s1, unsigned s2)
     const override
   {
-    std::vector<bool> ctrl(Config::nBit);
-    for(auto v : ixs.as_vector())
-      ctrl[v] = true;
-    ctrl[tgt] = true;
-    if(ctrl[s1] == ctrl[s2]) // swapping has no effect
+    Backend::Controls all{ixs.mask() | std::uint64_t(1) << tgt};
+    Backend::Controls swapped = Backend::Controls::swapQubits(all, s1, s2);
+    if(swapped == all) // swapping has no effect
       return self;
-    // if they are different then swapping amounts to negation
-    ctrl[s1] = !ctrl[s1];
-    ctrl[s2] = !ctrl[s2];
-    unsigned tgt_;
-    for(tgt_ = 0; tgt_ < Config::nBit; tgt_++)
-      if(ctrl[tgt_])
-        break;
-    ctrl[tgt_] = false;
-    Backend::Controls ixs_{ctrl};
+    unsigned tgt_ = lowest(swapped.mask());
+    Backend::Controls ixs_{swapped.mask() & ~(std::uint64_t(1) << tgt_)};
     return std::make_shared<CPhaseTemp>(tgt_, angle, ixs_);
   }
 
+  std::vector<Pointer> lift(const Pointer&) const override {
+    return lift_copy<lr>(Pointer{std::make_shared<CPhaseTemp>(
+        lift_qubit<lr>(tgt), angle, lift_controls<lr, cc>(ixs))});
+  }
+
   unsigned type() const override {
     return GateBase::Indexer::index(this);
   }
@@ -126,47 +141,66 @@ public:
     p.addControlledGate("Φ", tgt, ixs.as_vector());
   }
 
+  bool encode(QGA::internal::GeneCode& code) const override {
+    code.tgt = tgt;
+    code.ctrl = ixs.mask();
+    code.nAngles = 1;
+    code.angles[0] = double(angle);
+    return true;
+  }
+
   static Pointer read(const std::string& s) {
-    std::string reS{};
-    regex::regex re{"P(\\d+)\\((-?[0-9.]+)(π)?\\)"};
-    regex::matches ms{};
-    if(!re.match(s, ms))
+    QGA::internal::Scanner sc{s};
+    std::uint64_t bits;
+    double angle;
+    if(!(sc.lit("P") && sc.qubits(bits, ~0u) && sc.lit("(")
+          && sc.angle(angle) && sc.lit(")") && sc.done()) || !bits)
+      return {};
+    // as in the constructor, the lowest qubit becomes the target
+    unsigned tgt = lowest(bits);
+    return std::make_shared<CPhaseTemp>(tgt, Angle{angle},
+        Backend::Controls{bits & ~(std::uint64_t(1) << tgt)});
+  }
+
+  static Pointer decode(const QGA::internal::GeneCode& code) {
+    // as in read(), the target is the lowest qubit involved
+    if(!code.fits(1) || (code.ctrl & ((std::uint64_t(1) << code.tgt) - 1)))
       return {};
-    std::vector<bool> ctrl(Config::nBit, false);
-    unsigned tgt = (unsigned)(~0);
-    for(auto c : ms.match(1)) {
-      size_t pos = c - '1';
-      if(pos >= 0 && pos < Config::nBit && pos != tgt) {
-        if(tgt == (unsigned)(~0))
-          tgt = pos;
-        else
-          ctrl[pos] = true;
-      }
-    }
-    double angle = std::stod(ms.match(2)) * Const::pi;
-    return std::make_shared<CPhaseTemp>(tgt, angle, Backend::Controls{ctrl});
+    return std::make_shared<CPhaseTemp>(code.tgt, Angle{code.angles[0]},
+        Backend::Controls{code.ctrl});
   }
 
 private:
 
+  // The lowest qubit in a nonzero mask
+  static unsigned lowest(std::uint64_t bits) {
+    unsigned q = 0;
+    while(!(bits >> q & 1))
+      q++;
+    return q;
+  }
+
   unsigned tgt;
-  double angle;
+  Angle angle;
   Backend::Controls ixs;
   Backend::Gate mat;
 
-}; // class CPhase<Controls>::CPhaseTemp<GateBase>
+}; // class CPhase<Controls, Lift>::CPhaseTemp<GateBase>
 
 template<class GateBase>
 using Template = CPhaseTemp<GateBase>;
 
 template<Controls cc_>
-using WithControls = CPhase<cc_>;
+using WithControls = CPhase<cc_, lr>;
+
+template<Lift lr_>
+using WithLift = CPhase<cc, lr_>;
 
-}; // struct CPhase<Controls>
+}; // struct CPhase<Controls, Lift>
 
 } // namespace internal
 
-using CPhase = internal::CPhase<Controls::ANY>;
+using CPhase = internal::CPhase<Controls::ANY, Lift::KEEP>;
 
 } // namespace Gates
 
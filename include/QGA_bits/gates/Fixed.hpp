@@ -28,7 +28,7 @@ namespace {
 
 } // anonymous inner namespace
 
-template<Controls cc, const std::vector<gate_struct_f>* gates>
+template<Controls cc, const std::vector<gate_struct_f>* gates, Lift lr>
 struct Fixed {
 
 template<class GateBase>
@@ -52,6 +52,16 @@ public:
   FixedTemp(size_t op_, unsigned tgt_, const Backend::Controls& ixs_):
     op(op_), tgt(tgt_), ixs(ixs_) { }
 
+  // a random gate, interned
+  static Pointer random() {
+    size_t op = std::uniform_int_distribution<size_t>{1, gates->size() - 1}
+      (gen::rng);
+    unsigned tgt = std::uniform_int_distribution<unsigned>{0,
+      Config::nBit - 1}(gen::rng);
+    return make(op, tgt, controls_distribution<cc>{Config::nBit, tgt,
+        Config::pControl}(gen::rng));
+  }
+
   Backend::State applyTo(const Backend::State& psi, const Ctx*) const override {
     return psi.apply_ctrl(*(*gates)[op].op, ixs, tgt);
   }
@@ -64,25 +74,39 @@ public:
     return ixs.size();
   }
 
+  std::vector<unsigned> qubits() const override {
+    std::vector<unsigned> ret = ixs.as_vector();
+    ret.push_back(tgt);
+    return ret;
+  }
+
+  bool pack(QGA::internal::PackedGate& p) const override {
+    p = QGA::internal::PackedGate::ctrl(*(*gates)[op].op, ixs, tgt);
+    return true;
+  }
+
   Pointer getAnother() const override {
-    return std::make_shared<FixedTemp>();
+    return random();
   }
 
   Pointer invert(const Pointer& self) const override {
     int dIx = (*gates)[op].inv;
     if(dIx != 0)
-      return std::make_shared<FixedTemp>(op + dIx, tgt, ixs);
+      return make(op + dIx, tgt, ixs);
     else
       return self;
   }
 
   Pointer swapQubits(const Pointer&, unsigned s1, unsigned s2) const override {
-    return std::make_shared<FixedTemp>(
-        op,
-        tgt == s1 ? s2 : tgt == s2 ? s1 : tgt,
+    return make(op, tgt == s1 ? s2 : tgt == s2 ? s1 : tgt,
         Backend::Controls::swapQubits(ixs, s1, s2));
   }
 
+  std::vector<Pointer> lift(const Pointer&) const override {
+    return lift_copy<lr>(make(op, lift_qubit<lr>(tgt),
+          lift_controls<lr, cc>(ixs)));
+  }
+
   unsigned type() const override {
     return GateBase::Indexer::index(this);
   }
@@ -101,7 +125,7 @@ public:
       return {};
     // G * G = square(G) if also among our operations
     if((*gates)[op].sq != 0)
-      return std::make_shared<FixedTemp>(op + (*gates)[op].sq, tgt, ixs);
+      return make(op + (*gates)[op].sq, tgt, ixs);
     else
       return {};
   }
@@ -121,54 +145,64 @@ public:
     p.addControlledGate((*gates)[op].name, tgt, ixs.as_vector());
   }
 
+  bool encode(QGA::internal::GeneCode& code) const override {
+    code.op = op;
+    code.tgt = tgt;
+    code.ctrl = ixs.mask();
+    return true;
+  }
+
   static Pointer read(const std::string& s) {
-    std::string reS{};
-    for(const gate_struct_f& g : *gates)
-      reS = reS + "|(" + g.name + ")";
-    regex::regex re{"(?:" + reS.substr(1) + ")(\\d)(\\[(\\d+)\\])?"};
-    regex::matches ms{};
-    if(!re.match(s, ms))
-      return {};
-    size_t num = gates->size();
+    QGA::internal::Scanner sc{s};
     size_t op;
-    for(op = 0; op < num; op++)
-      if(ms.matched(op + 1))
-        break;
-    unsigned tgt = ms.match(num + 1)[0] - '1';
-    if(tgt >= Config::nBit)
+    unsigned tgt;
+    std::uint64_t ctrl;
+    if(!(sc.name(*gates, op) && sc.qubit(tgt) && sc.controls(ctrl, tgt)
+          && sc.done()))
+      return {};
+    return make(op, tgt, Backend::Controls{ctrl});
+  }
+
+  static Pointer decode(const QGA::internal::GeneCode& code) {
+    if(code.op >= gates->size() || !code.fits(0))
       return {};
-    std::vector<bool> ctrl(Config::nBit, false);
-    if(ms.matched(num + 2))
-      for(auto c : ms.match(num + 3)) {
-        size_t pos = c - '1';
-        if(pos >= 0 && pos < Config::nBit && pos != tgt)
-          ctrl[pos] = true;
-      }
-    return std::make_shared<FixedTemp>(op, tgt, Backend::Controls{ctrl});
+    return make(code.op, code.tgt, Backend::Controls{code.ctrl});
   }
 
 private:
 
+  static Pointer make(size_t op, unsigned tgt, const Backend::Controls& ixs) {
+    size_t key = (op * Config::nBit + tgt) << Config::nBit | ixs.mask();
+    return Interned<FixedTemp, Pointer>::get(key,
+        gates->size() * Config::nBit << Config::nBit, [&]() -> Pointer {
+          return std::make_shared<FixedTemp>(op, tgt, ixs);
+        });
+  }
+
   size_t op;
   unsigned tgt;
   Backend::Controls ixs;
 
-}; // class Fixed<Controls, Gates>::FixedTemp<GateBase>
+}; // class Fixed<Controls, Gates, Lift>::FixedTemp<GateBase>
 
 template<class GateBase>
 using Template = FixedTemp<GateBase>;
 
 template<Controls cc_>
-using WithControls = Fixed<cc_, gates>;
+using WithControls = Fixed<cc_, gates, lr>;
 
 template<const std::vector<gate_struct_f>* gates_>
-using WithGates = Fixed<cc, gates_>;
+using WithGates = Fixed<cc, gates_, lr>;
+
+template<Lift lr_>
+using WithLift = Fixed<cc, gates, lr_>;
 
-}; // struct Fixed<Controls, Gates>
+}; // struct Fixed<Controls, Gates, Lift>
 
 } // namespace internal
 
-using Fixed = internal::Fixed<Controls::NONE, &internal::gates_fixed>;
+using Fixed = internal::Fixed<Controls::NONE, &internal::gates_fixed,
+      Lift::KEEP>;
 
 } // namespace Gates
 
@@ -0,0 +1,239 @@
+namespace QGA {
+
+namespace Gates {
+
+namespace internal {
+
+/* A frozen sub-circuit taken from the run-wide module library, see
+ * CandidateBase::harvestModules(). Its unitary is computed once, on the
+ * qubits the sub-circuit acts on, and applied as a single block. Modules
+ * can't use the circuit's Context, so they are only available in problems
+ * where it is void. */
+
+struct Module {
+
+template<class GateBase>
+class ModuleTemp : public GateBase {
+
+  using typename GateBase::Pointer;
+  using Ctx = typename GateBase::Context;
+
+  struct Entry {
+    unsigned id;                   // index in library() it derives from
+    std::vector<Pointer> gates;
+    std::vector<unsigned> qubits;  // ascending
+    std::vector<Backend::cxd> mat; // row-major, on qubits
+  };
+
+  using EntryPtr = std::shared_ptr<const Entry>;
+
+public:
+
+  // pick a random module from the library (an identity if there is none)
+  ModuleTemp(): entry() {
+    const std::vector<EntryPtr>& lib = library();
+    if(lib.empty())
+      return;
+    entry = lib[std::uniform_int_distribution<size_t>{0, lib.size() - 1}
+      (gen::rng)];
+  }
+
+  ModuleTemp(const EntryPtr& entry_): entry(entry_) { }
+
+  /* Adds a module made of gates to the library. Fails if it acts on more
+   * than maxQubits qubits or if it is already there. Must not be called
+   * during a parallel evaluation. */
+  static bool add(const std::vector<Pointer>& gates, unsigned maxQubits) {
+    std::vector<EntryPtr>& lib = library();
+    EntryPtr e = makeEntry(lib.size(), gates);
+    if(e->qubits.size() > maxQubits)
+      return false;
+    std::string text = body(*e);
+    for(const auto& other : lib)
+      if(body(*other) == text)
+        return false;
+    lib.push_back(e);
+    return true;
+  }
+
+  static size_t count() {
+    return library().size();
+  }
+
+  // The library entry with the given id as a gate
+  static Pointer get(unsigned id) {
+    return std::make_shared<ModuleTemp>(library()[id]);
+  }
+
+  Backend::State applyTo(const Backend::State& psi, const Ctx*) const override {
+    return entry ? psi.apply_block(entry->mat, entry->qubits) : psi;
+  }
+
+  unsigned controls() const override {
+    unsigned ret = 0;
+    if(entry)
+      for(const auto& g : entry->gates)
+        ret += g->controls();
+    return ret;
+  }
+
+  std::vector<unsigned> qubits() const override {
+    return entry ? entry->qubits : std::vector<unsigned>{};
+  }
+
+  bool isTrivial() const override {
+    return !entry;
+  }
+
+  Pointer getAnother() const override {
+    return std::make_shared<ModuleTemp>();
+  }
+
+  Pointer invert(const Pointer& self) const override {
+    if(!entry)
+      return self;
+    std::vector<Pointer> gates{};
+    for(auto it = entry->gates.rbegin(); it != entry->gates.rend(); it++)
+      gates.push_back((*it)->invert(*it));
+    size_t bd = size_t(1) << entry->qubits.size();
+    std::vector<Backend::cxd> mat(bd * bd);
+    for(size_t r = 0; r < bd; r++)
+      for(size_t c = 0; c < bd; c++)
+        mat[r * bd + c] = std::conj(entry->mat[c * bd + r]);
+    return std::make_shared<ModuleTemp>(std::make_shared<Entry>(
+          Entry{entry->id, std::move(gates), entry->qubits, std::move(mat)}));
+  }
+
+  Pointer swapQubits(const Pointer& self, unsigned s1, unsigned s2)
+    const override
+  {
+    if(!entry)
+      return self;
+    std::vector<Pointer> gates{};
+    for(const auto& g : entry->gates)
+      gates.push_back(g->swapQubits(g, s1, s2));
+    return std::make_shared<ModuleTemp>(makeEntry(entry->id, gates));
+  }
+
+  // The module is dissolved into its gates, which lift by their own rules
+  std::vector<Pointer> lift(const Pointer& self) const override {
+    if(!entry)
+      return {self};
+    std::vector<Pointer> ret{};
+    for(const auto& g : entry->gates) {
+      std::vector<Pointer> lifted = g->lift(g);
+      ret.insert(ret.end(), lifted.begin(), lifted.end());
+    }
+    return ret;
+  }
+
+  unsigned type() const override {
+    return GateBase::Indexer::index(this);
+  }
+
+  const ModuleTemp* cast(const ModuleTemp*) const override {
+    return this;
+  }
+
+  bool sameType(const GateBase& other) const override {
+    const ModuleTemp* c = other.cast(this);
+    return c != nullptr && c->entry == entry;
+  }
+
+  Pointer merge(const GateBase&) const override {
+    return {};
+  }
+
+  std::ostream& write(std::ostream& os) const override {
+    if(!entry)
+      return os << "[Id]";
+    return os << 'M' << entry->id + 1 << body(*entry);
+  }
+
+  void printOn(QGA::CircuitPrinter& p) const override {
+    if(entry)
+      for(const auto& g : entry->gates)
+        g->printOn(p);
+  }
+
+  /* Only the module number is read back, so this gives the module as it
+   * is in the library of this run. */
+  static Pointer read(const std::string& s) {
+    QGA::internal::Scanner sc{s};
+    unsigned long n;
+    if(!(sc.lit("M") && sc.number(n) && sc.lit("{")) || s.back() != '}')
+      return {};
+    if(n == 0 || n > count())
+      return {};
+    return get(n - 1);
+  }
+
+  /* Modules depend on the library of the run and have no compact form, see
+   * GateBase::encode(). */
+  static Pointer decode(const QGA::internal::GeneCode&) {
+    return {};
+  }
+
+private:
+
+  static std::vector<EntryPtr>& library() {
+    static std::vector<EntryPtr> lib{};
+    return lib;
+  }
+
+  // The gates of the module in a form which contains no whitespace
+  static std::string body(const Entry& e) {
+    std::ostringstream os{};
+    os << '{';
+    for(size_t k = 0; k < e.gates.size(); k++)
+      os << (k ? ";" : "") << *e.gates[k];
+    os << '}';
+    return os.str();
+  }
+
+  /* Finds the qubits the gates act on and computes their unitary there,
+   * simulating them on all basis states of these qubits (the others being
+   * set to 0). */
+  static EntryPtr makeEntry(unsigned id, const std::vector<Pointer>& gates) {
+    std::vector<bool> used(Config::nBit);
+    for(const auto& g : gates)
+      for(unsigned q : g->qubits())
+        used[q] = true;
+    std::vector<unsigned> qubits{};
+    for(unsigned q = 0; q < Config::nBit; q++)
+      if(used[q])
+        qubits.push_back(q);
+    size_t bd = size_t(1) << qubits.size();
+    std::vector<size_t> index(bd);
+    for(size_t j = 0; j < bd; j++)
+      for(size_t b = 0; b < qubits.size(); b++)
+        if(j >> (qubits.size() - 1 - b) & 1)
+          index[j] |= size_t(1) << (Config::nBit - 1 - qubits[b]);
+    std::vector<Backend::cxd> mat(bd * bd);
+    for(size_t c = 0; c < bd; c++) {
+      Backend::State psi{index[c]};
+      for(const auto& g : gates)
+        psi = g->applyTo(psi);
+      for(size_t r = 0; r < bd; r++)
+        mat[r * bd + c] = psi[index[r]];
+    }
+    return std::make_shared<Entry>(Entry{id, gates, std::move(qubits),
+        std::move(mat)});
+  }
+
+  EntryPtr entry;
+
+}; // class Module::ModuleTemp<GateBase>
+
+template<class GateBase>
+using Template = ModuleTemp<GateBase>;
+
+}; // struct Module
+
+} // namespace internal
+
+using Module = internal::Module;
+
+} // namespace Gates
+
+} // namespace QGA
@@ -4,7 +4,7 @@ namespace Gates {
 
 namespace internal {
 
-template<Controls cc>
+template<Controls cc, Lift lr>
 struct SU2 {
 
 template<class GateBase>
@@ -24,25 +24,30 @@ public:
     angle3(angle_distribution<>{}(gen::rng)),
     ixs(controls_distribution<cc>{Config::nBit, tgt, Config::pControl}
         (gen::rng)),
-    mat(func::zrot(angle3) * func::yrot(angle2) * func::zrot(angle1))
+    mat(matrix(angle1, angle2, angle3))
   { }
 
   // construct using parameters
-  SU2Temp(unsigned tgt_, double angle1_, double angle2_, double angle3_,
+  SU2Temp(unsigned tgt_, Angle angle1_, Angle angle2_, Angle angle3_,
       const Backend::Controls& ixs_):
     tgt(tgt_), angle1(angle1_), angle2(angle2_), angle3(angle3_), ixs(ixs_),
-    mat(func::zrot(angle3) * func::yrot(angle2) * func::zrot(angle1))
+    mat(matrix(angle1, angle2, angle3))
   { }
 
   // construct from a product matrix
-  SU2Temp(unsigned tgt_, const Backend::Controls& ixs_, Backend::Gate&& mat_):
+  SU2Temp(unsigned tgt_, const Backend::Controls& ixs_,
+      const Backend::Gate& mat_):
     tgt(tgt_), angle1(), angle2(), angle3(), ixs(ixs_), mat(mat_)
   {
-    angle2 = std::atan2(std::abs(mat(1, 0)), std::abs(mat(0, 0)));
+    angle2 = Angle{std::atan2(std::abs(mat(1, 0)), std::abs(mat(0, 0)))};
     double sum = std::arg(mat(0, 0)),
            diff = std::arg(mat(1, 0));
-    angle1 = (sum + diff) / 2.0;
-    angle3 = (sum - diff) / 2.0;
+    angle1 = Angle{(sum + diff) / 2.0};
+    angle3 = Angle{(sum - diff) / 2.0};
+#ifdef ANGLE_BITS
+    // keep the matrix consistent with the rounded angles
+    mat = matrix(angle1, angle2, angle3);
+#endif
   }
 
   Backend::State applyTo(const Backend::State& psi, const Ctx*) const override {
@@ -57,6 +62,36 @@ public:
     return ixs.size();
   }
 
+  std::vector<unsigned> qubits() const override {
+    std::vector<unsigned> ret = ixs.as_vector();
+    ret.push_back(tgt);
+    return ret;
+  }
+
+  bool pack(QGA::internal::PackedGate& p) const override {
+    p = QGA::internal::PackedGate::ctrl(mat, ixs, tgt);
+    return true;
+  }
+
+  std::vector<double> params() const override {
+    return {angle1, angle2, angle3};
+  }
+
+  Backend::State applyDiff(const Backend::State& psi, unsigned ix,
+      const Ctx*) const override {
+    Backend::Gate dmat = ix == 0
+      ? func::zrot(angle3) * func::yrot(angle2) * diff_rot(func::zrot, angle1)
+      : ix == 1
+      ? func::zrot(angle3) * diff_rot(func::yrot, angle2) * func::zrot(angle1)
+      : diff_rot(func::zrot, angle3) * func::yrot(angle2) * func::zrot(angle1);
+    return apply_ctrl_diff(psi, dmat, ixs, tgt);
+  }
+
+  Pointer withParams(const Pointer&, const double* values) const override {
+    return std::make_shared<SU2Temp>(tgt,
+        Angle{values[0]}, Angle{values[1]}, Angle{values[2]}, ixs);
+  }
+
   Pointer getAnother() const override {
     return std::make_shared<SU2Temp>();
   }
@@ -68,9 +103,9 @@ public:
   Pointer mutate(const Pointer&) const override {
     angle_distribution<true> dAng{};
     return std::make_shared<SU2Temp>(tgt,
-        angle1 + dAng(gen::rng),
-        angle2 + dAng(gen::rng),
-        angle3 + dAng(gen::rng),
+        angle1 + Angle{dAng(gen::rng)},
+        angle2 + Angle{dAng(gen::rng)},
+        angle3 + Angle{dAng(gen::rng)},
         ixs);
   }
 
@@ -89,6 +124,12 @@ public:
         Backend::Controls::swapQubits(ixs, s1, s2));
   }
 
+  std::vector<Pointer> lift(const Pointer&) const override {
+    return lift_copy<lr>(Pointer{std::make_shared<SU2Temp>(
+        lift_qubit<lr>(tgt), angle1, angle2, angle3,
+        lift_controls<lr, cc>(ixs))});
+  }
+
   unsigned type() const override {
     return GateBase::Indexer::index(this);
   }
@@ -106,8 +147,7 @@ public:
     if(!sameType(other))
       return {};
     const SU2Temp* c = other.cast(this);
-    return std::make_shared<SU2Temp>(tgt, ixs,
-        static_cast<Backend::Gate>(c->mat * mat));
+    return std::make_shared<SU2Temp>(tgt, ixs, c->mat * mat);
   }
 
   std::ostream& write(std::ostream& os) const override {
@@ -129,53 +169,67 @@ public:
     p.addControlledGate("U", tgt, ixs.as_vector());
   }
 
+  bool encode(QGA::internal::GeneCode& code) const override {
+    code.tgt = tgt;
+    code.ctrl = ixs.mask();
+    code.nAngles = 3;
+    code.angles[0] = double(angle1);
+    code.angles[1] = double(angle2);
+    code.angles[2] = double(angle3);
+    return true;
+  }
+
   static Pointer read(const std::string& s) {
-    std::string reS{};
-    regex::regex re{"U(\\d)(\\[(\\d+)\\])?"
-      "\\((-?[0-9.]+)(?:π)?,(-?[0-9.]+)(?:π)?,(-?[0-9.]+)(?:π)?\\)"};
-    regex::matches ms{};
-    if(!re.match(s, ms))
+    QGA::internal::Scanner sc{s};
+    unsigned tgt;
+    std::uint64_t ctrl;
+    double a1, a2, a3;
+    if(!(sc.lit("U") && sc.qubit(tgt) && sc.controls(ctrl, tgt)
+          && sc.lit("(") && sc.angle(a1) && sc.lit(",") && sc.angle(a2)
+          && sc.lit(",") && sc.angle(a3) && sc.lit(")") && sc.done()))
       return {};
-    unsigned tgt = ms.match(1)[0] - '1';
-    if(tgt >= Config::nBit)
-      return {};
-    std::vector<bool> ctrl(Config::nBit, false);
-    if(ms.matched(2))
-      for(auto c : ms.match(3)) {
-        size_t pos = c - '1';
-        if(pos >= 0 && pos < Config::nBit && pos != tgt)
-          ctrl[pos] = true;
-      }
-    double angle1 = std::stod(ms.match(4)) * Const::pi,
-           angle2 = std::stod(ms.match(5)) * Const::pi,
-           angle3 = std::stod(ms.match(6)) * Const::pi;
-    return std::make_shared<SU2Temp>(tgt,
-        angle1, angle2, angle3,
+    return std::make_shared<SU2Temp>(tgt, Angle{a1}, Angle{a2}, Angle{a3},
         Backend::Controls{ctrl});
   }
 
+  static Pointer decode(const QGA::internal::GeneCode& code) {
+    if(!code.fits(3))
+      return {};
+    return std::make_shared<SU2Temp>(code.tgt, Angle{code.angles[0]},
+        Angle{code.angles[1]}, Angle{code.angles[2]},
+        Backend::Controls{code.ctrl});
+  }
+
 private:
 
+  static Backend::Gate matrix(Angle a1, Angle a2, Angle a3) {
+    return func::gate(func::zrot, a3) * func::gate(func::yrot, a2)
+      * func::gate(func::zrot, a1);
+  }
+
   unsigned tgt;
-  double angle1;
-  double angle2;
-  double angle3;
+  Angle angle1;
+  Angle angle2;
+  Angle angle3;
   Backend::Controls ixs;
   Backend::Gate mat;
 
-}; // class SU2<Controls>::SU2Temp<GateBase>
+}; // class SU2<Controls, Lift>::SU2Temp<GateBase>
 
 template<class GateBase>
 using Template = SU2Temp<GateBase>;
 
 template<Controls cc_>
-using WithControls = SU2<cc_>;
+using WithControls = SU2<cc_, lr>;
+
+template<Lift lr_>
+using WithLift = SU2<cc, lr_>;
 
-}; // struct SU2<Controls>
+}; // struct SU2<Controls, Lift>
 
 } // namespace internal
 
-using SU2 = internal::SU2<Controls::NONE>;
+using SU2 = internal::SU2<Controls::NONE, Lift::KEEP>;
 
 } // namespace Gates
 
@@ -2,6 +2,9 @@ namespace QGA {
 
 namespace Gates {
 
+namespace internal {
+
+template<Lift lr>
 struct SWAP {
 
 template<class GateBase>
@@ -18,27 +21,44 @@ public:
         (gen::rng)), // NB the -2 is important!
     s2(std::uniform_int_distribution<unsigned>{0, Config::nBit - 2}
         (gen::rng)),
-    ixs(), odd(true)
+    odd(true)
   {
     // ensure that the two systems are different and in ascending order
     if(s2 < s1)
       std::swap(s1, s2);
     s2 += s2 >= s1;
-    ixs = Backend::Controls::swapGate(s1, s2);
   }
 
   // construct using parameters
-  SWAPTemp(unsigned s1_, unsigned s2_, const Backend::Controls& ixs_, bool odd_):
-      s1(s1_), s2(s2_), ixs(ixs_), odd(odd_) { }
-
   SWAPTemp(unsigned s1_, unsigned s2_):
-    s1(std::min(s1_, s2_)), s2(std::max(s1_, s2_)),
-    ixs(std::move(Backend::Controls::swapGate(s1, s2))), odd(true) { }
+    s1(std::min(s1_, s2_)), s2(std::max(s1_, s2_)), odd(true) { }
 
-  SWAPTemp(bool): s1(), s2(), ixs(), odd(false) { }
+  SWAPTemp(bool): s1(), s2(), odd(false) { }
+
+  // a random gate, interned
+  static Pointer random() {
+    unsigned s1 = std::uniform_int_distribution<unsigned>{0, Config::nBit - 2}
+        (gen::rng),
+             s2 = std::uniform_int_distribution<unsigned>{0, Config::nBit - 2}
+        (gen::rng);
+    if(s2 < s1)
+      std::swap(s1, s2);
+    s2 += s2 >= s1;
+    return make(s1, s2);
+  }
 
   Backend::State applyTo(const Backend::State& psi, const Ctx*) const override {
-    return odd ? psi.swapQubits(ixs) : psi;
+    return odd ? psi.swapQubits(s1, s2) : psi;
+  }
+
+  std::vector<unsigned> qubits() const override {
+    return {s1, s2};
+  }
+
+  bool pack(QGA::internal::PackedGate& p) const override {
+    p = odd ? QGA::internal::PackedGate::swap(s1, s2)
+      : QGA::internal::PackedGate::identity();
+    return true;
   }
 
   bool isTrivial() const override {
@@ -47,7 +67,7 @@ public:
   }
 
   Pointer getAnother() const override {
-    return std::make_shared<SWAPTemp>();
+    return random();
   }
 
   Pointer mutate(const Pointer&) const override {
@@ -59,11 +79,17 @@ public:
   {
     if((sw1 == s1 && sw2 == s2) || (sw1 == s2 && sw2 == s1) || !odd)
       return self; // no action
-    return std::make_shared<SWAPTemp>(
+    return make(
         s1 == sw1 ? sw2 : s1 == sw2 ? sw1 : s1,
         s2 == sw1 ? sw2 : s2 == sw2 ? sw1 : s2);
   }
 
+  std::vector<Pointer> lift(const Pointer& self) const override {
+    if(!odd)
+      return {self};
+    return lift_copy<lr>(make(lift_qubit<lr>(s1), lift_qubit<lr>(s2)));
+  }
+
   unsigned type() const override {
     return GateBase::Indexer::index(this);
   }
@@ -81,7 +107,7 @@ public:
     if(!sameType(other))
       return {};
     const SWAPTemp* c = other.cast(this);
-    return std::make_shared<SWAPTemp>(s1, s2, ixs, odd ^ c->odd);
+    return make(s1, s2, odd ^ c->odd);
   }
 
   std::ostream& write(std::ostream& os) const override {
@@ -96,32 +122,70 @@ public:
       p.addSwapGate(s1, s2);
   }
 
+  // The second qubit is kept in code.ctrl
+  bool encode(QGA::internal::GeneCode& code) const override {
+    code.op = odd;
+    code.tgt = s1;
+    code.ctrl = odd ? std::uint64_t(1) << s2 : 0;
+    return true;
+  }
+
   static Pointer read(const std::string& s) {
-    regex::regex re{"(\\[Id\\])|SWAP(\\d)(\\d)"};
-    regex::matches ms{};
-    if(!re.match(s, ms))
+    QGA::internal::Scanner sc{s};
+    if(sc.lit("[Id]"))
+      return sc.done() ? make(0, 0, false) : Pointer{};
+    unsigned s1, s2;
+    if(!(sc.lit("SWAP") && sc.qubit(s1) && sc.qubit(s2) && sc.done())
+        || s2 == s1)
       return {};
-    if(ms.matched(1))
-      return std::make_shared<SWAPTemp>(false);
-    unsigned s1 = ms.match(2)[0] - '1',
-             s2 = ms.match(3)[0] - '1';
-    if(s1 >= Config::nBit || s2 >= Config::nBit || s2 == s1)
+    return make(s1, s2);
+  }
+
+  static Pointer decode(const QGA::internal::GeneCode& code) {
+    if(code.op > 1 || !code.fits(0))
       return {};
-    return std::make_shared<SWAPTemp>(s1, s2);
+    if(!code.op)
+      return code.tgt || code.ctrl ? Pointer{} : make(0, 0, false);
+    // exactly one bit, above tgt as in make()
+    if(!code.ctrl || (code.ctrl & (code.ctrl - 1))
+        || code.ctrl >> code.tgt <= 1)
+      return {};
+    unsigned s2 = 0;
+    while(!(code.ctrl >> s2 & 1))
+      s2++;
+    return make(code.tgt, s2);
   }
 
 private:
 
+  // The identity (odd = false) has one instance for all s1 and s2
+  static Pointer make(unsigned s1, unsigned s2, bool odd = true) {
+    size_t size = Config::nBit * Config::nBit + 1;
+    if(!odd)
+      return Interned<SWAPTemp, Pointer>::get(size - 1, size,
+          []() -> Pointer { return std::make_shared<SWAPTemp>(false); });
+    if(s2 < s1)
+      std::swap(s1, s2);
+    return Interned<SWAPTemp, Pointer>::get(s1 * Config::nBit + s2, size,
+        [=]() -> Pointer { return std::make_shared<SWAPTemp>(s1, s2); });
+  }
+
   unsigned s1, s2;
-  Backend::Controls ixs;
   bool odd;  // parity of the power
 
-}; // class SWAP::SWAPTemp<GateBase>
+}; // class SWAP<Lift>::SWAPTemp<GateBase>
 
 template<class GateBase>
 using Template = SWAPTemp<GateBase>;
 
-}; // struct SWAP
+template<Lift lr_>
+using WithLift = SWAP<lr_>;
+
+}; // struct SWAP<Lift>
+
+} // namespace internal
+
+using SWAP = internal::SWAP<Lift::KEEP>;
 
 } // namespace Gates
 
@@ -39,7 +39,7 @@ namespace {
 
 } // anonymous inner namespace
 
-template<Controls cc, const std::vector<gate_struct_p>* gates>
+template<Controls cc, const std::vector<gate_struct_p>* gates, Lift lr>
 struct Param {
 
 template<class GateBase>
@@ -58,13 +58,14 @@ public:
     angle(angle_distribution<>{}(gen::rng)),
     ixs(controls_distribution<cc>{Config::nBit, tgt, Config::pControl}
         (gen::rng)),
-    mat((*gates)[op].fn(angle))
+    mat(func::gate((*gates)[op].fn, angle))
   { }
 
   // construct using parameters
-  ParamTemp(size_t op_, unsigned tgt_, double angle_,
+  ParamTemp(size_t op_, unsigned tgt_, Angle angle_,
       const Backend::Controls& ixs_):
-    op(op_), tgt(tgt_), angle(angle_), ixs(ixs_), mat((*gates)[op].fn(angle))
+    op(op_), tgt(tgt_), angle(angle_), ixs(ixs_),
+    mat(func::gate((*gates)[op].fn, angle))
   { }
 
   Backend::State applyTo(const Backend::State& psi, const Ctx*) const override {
@@ -79,6 +80,30 @@ public:
     return ixs.size();
   }
 
+  std::vector<unsigned> qubits() const override {
+    std::vector<unsigned> ret = ixs.as_vector();
+    ret.push_back(tgt);
+    return ret;
+  }
+
+  bool pack(QGA::internal::PackedGate& p) const override {
+    p = QGA::internal::PackedGate::ctrl(mat, ixs, tgt);
+    return true;
+  }
+
+  std::vector<double> params() const override {
+    return {angle};
+  }
+
+  Backend::State applyDiff(const Backend::State& psi, unsigned,
+      const Ctx*) const override {
+    return apply_ctrl_diff(psi, diff_rot((*gates)[op].fn, angle), ixs, tgt);
+  }
+
+  Pointer withParams(const Pointer&, const double* values) const override {
+    return std::make_shared<ParamTemp>(op, tgt, Angle{values[0]}, ixs);
+  }
+
   Pointer getAnother() const override {
     return std::make_shared<ParamTemp>();
   }
@@ -89,7 +114,8 @@ public:
 
   Pointer mutate(const Pointer&) const override {
     angle_distribution<true> dAng{};
-    return std::make_shared<ParamTemp>(op, tgt, angle + dAng(gen::rng), ixs);
+    return std::make_shared<ParamTemp>(op, tgt, angle + Angle{dAng(gen::rng)},
+        ixs);
   }
 
   Pointer simplify(const Pointer&) const override {
@@ -104,6 +130,11 @@ public:
         Backend::Controls::swapQubits(ixs, s1, s2));
   }
 
+  std::vector<Pointer> lift(const Pointer&) const override {
+    return lift_copy<lr>(Pointer{std::make_shared<ParamTemp>(
+        op, lift_qubit<lr>(tgt), angle, lift_controls<lr, cc>(ixs))});
+  }
+
   unsigned type() const override {
     return GateBase::Indexer::index(this);
   }
@@ -140,61 +171,69 @@ public:
     p.addControlledGate((*gates)[op].name, tgt, ixs.as_vector());
   }
 
+  bool encode(QGA::internal::GeneCode& code) const override {
+    code.op = op;
+    code.tgt = tgt;
+    code.ctrl = ixs.mask();
+    code.nAngles = 1;
+    code.angles[0] = double(angle);
+    return true;
+  }
+
   static Pointer read(const std::string& s) {
-    std::string reS{};
-    for(const gate_struct_p& g : *gates)
-      reS = reS + "|(" + g.name + ")";
-    regex::regex re{"(?:" + reS.substr(1) + ")" +
-      "(\\d)(\\[(\\d+)\\])?\\((-?[0-9.]+)(?:π)?\\)"};
-    regex::matches ms{};
-    if(!re.match(s, ms))
-      return {};
-    size_t num = gates->size();
+    QGA::internal::Scanner sc{s};
     size_t op;
-    for(op = 0; op < num; op++)
-      if(ms.matched(op + 1))
-        break;
-    unsigned tgt = ms.match(num + 1)[0] - '1';
-    if(tgt < 0 || tgt >= Config::nBit)
+    unsigned tgt;
+    std::uint64_t ctrl;
+    double angle;
+    if(!(sc.name(*gates, op) && sc.qubit(tgt) && sc.controls(ctrl, tgt)
+          && sc.lit("(") && sc.angle(angle) && sc.lit(")") && sc.done()))
       return {};
-    std::vector<bool> ctrl(Config::nBit, false);
-    if(ms.matched(num + 2))
-      for(auto c : ms.match(num + 3)) {
-        size_t pos = c - '1';
-        if(pos >= 0 && pos < Config::nBit && pos != tgt)
-          ctrl[pos] = true;
-      }
-    double angle = std::stod(ms.match(num + 4)) * Const::pi;
-    return std::make_shared<ParamTemp>(op, tgt, angle, Backend::Controls{ctrl});
+    return std::make_shared<ParamTemp>(op, tgt, Angle{angle},
+        Backend::Controls{ctrl});
+  }
+
+  static Pointer decode(const QGA::internal::GeneCode& code) {
+    if(code.op >= gates->size() || !code.fits(1))
+      return {};
+    return std::make_shared<ParamTemp>(code.op, code.tgt,
+        Angle{code.angles[0]}, Backend::Controls{code.ctrl});
   }
 
 private:
 
   size_t op;
   unsigned tgt;
-  double angle;
+  Angle angle;
   Backend::Controls ixs;
   Backend::Gate mat;
 
-}; // class Param<Controls, Gates>::ParamTemp<GateBase>
+}; // class Param<Controls, Gates, Lift>::ParamTemp<GateBase>
 
 template<class GateBase>
 using Template = ParamTemp<GateBase>;
 
 template<Controls cc_>
-using WithControls = Param<cc_, gates>;
+using WithControls = Param<cc_, gates, lr>;
 
 template<const std::vector<gate_struct_p>* gates_>
-using WithGates = Param<cc, gates_>;
+using WithGates = Param<cc, gates_, lr>;
+
+template<Lift lr_>
+using WithLift = Param<cc, gates, lr_>;
 
-}; // struct Param<Controls, Gates>
+}; // struct Param<Controls, Gates, Lift>
 
 } // namespace internal
 
-using XYZ = internal::Param<Controls::NONE, &internal::gates_param_xyz>;
-using X = internal::Param<Controls::NONE, &internal::gates_param_x>;
-using Y = internal::Param<Controls::NONE, &internal::gates_param_y>;
-using Z = internal::Param<Controls::NONE, &internal::gates_param_z>;
+using XYZ = internal::Param<Controls::NONE, &internal::gates_param_xyz,
+      Lift::KEEP>;
+using X = internal::Param<Controls::NONE, &internal::gates_param_x,
+      Lift::KEEP>;
+using Y = internal::Param<Controls::NONE, &internal::gates_param_y,
+      Lift::KEEP>;
+using Z = internal::Param<Controls::NONE, &internal::gates_param_z,
+      Lift::KEEP>;
 
 } // namespace Gates
 
@@ -4,19 +4,29 @@
 #include <complex>
 #include <string>
 #include <cstddef>
+#include <cstdint>
 
 #include <cmath>
+#include <cctype>
+#include <cstdlib>
 #include <limits>
+#include <atomic>
 #include <memory>
+#include <mutex>
 #include <random>
 #include <stdexcept>
 
 #include <iomanip>
+#include <fstream>
 #include <ostream>
 #include <sstream>
 
 #include <array>
+#include <bitset>
+#include <deque>
 #include <vector>
+#include <unordered_map>
+#include <unordered_set>
 #include <utility>
 #include <algorithm>
 #include <functional>
@@ -33,8 +43,31 @@ namespace Config {
   extern double expLengthIni;
   extern double expMutationCount;
   extern double expSliceLength;
+  extern std::string cacheFile;
+  extern bool bounded;
+  extern unsigned estProbes;
+  extern double estMargin;
+  extern size_t broodSize;
+  extern size_t maxLength;
+  extern double lengthFactor;
+  extern size_t genBudget;
+  extern std::string dataFile;
+  extern bool meanError;
+  extern unsigned noiseTraj;
+  extern double noiseDepol1;
+  extern double noiseDepol2;
+  extern double noiseDephase;
   extern const double pControl;
   extern const double dAlpha;
+  extern const unsigned fpProbes;
+  extern const unsigned optSteps;
+  extern const double pAudit;
+  extern const size_t canonWindow;
+  extern const size_t moduleLength;
+  extern const size_t moduleMinCount;
+  extern const unsigned moduleQubits;
+  extern const size_t moduleMax;
+  extern const unsigned long moduleEvery;
   extern const size_t circLineLength;
 }
 
@@ -45,6 +78,19 @@ namespace QGA {
     const double pi = std::acos(-1);
     const double v12 = 1/std::sqrt(2);
   }
+
+  namespace internal {
+    // FNV-1a hash of a sequence of bytes, continuing from a previous value
+    inline std::uint64_t fnv1a(const void* data, size_t len,
+        std::uint64_t hash = 14695981039346656037ULL) {
+      const unsigned char* bytes = static_cast<const unsigned char*>(data);
+      for(size_t i = 0; i < len; i++) {
+        hash ^= bytes[i];
+        hash *= 1099511628211ULL;
+      }
+      return hash;
+    }
+  }
 }
 
 #endif // !defined QGA_COMMONS_HPP
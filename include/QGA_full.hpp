@@ -3,15 +3,23 @@
 
 #include "QGA_commons.hpp"
 #include "genetic.hpp"
-#include "regex.hpp"
+#include "MappedFile.hpp"
 
 #include "QGA_bits/Backend.hpp"
 #include "QGA_bits/CircuitPrinter.hpp"
 #include "QGA_bits/Fitness.hpp"
+#include "QGA_bits/Fingerprint.hpp"
+#include "QGA_bits/DiskCache.hpp"
+#include "QGA_bits/Packed.hpp"
+#include "QGA_bits/Encoding.hpp"
 #include "QGA_bits/GateBase.hpp" // uses Fitness.hpp and CircuitPrinter.hpp
 #include "QGA_bits/Gene.hpp"     // uses GateBase.hpp
+#include "QGA_bits/GenotypeFile.hpp"
 #include "QGA_bits/Tools.hpp"
+#include "QGA_bits/Rope.hpp"     // uses Tools.hpp
 #include "QGA_bits/Gates.hpp"    // uses Tools.hpp and GateBase.hpp
+#include "QGA_bits/LBFGS.hpp"
+#include "QGA_bits/Noise.hpp"
 #include "QGA_bits/CandidateBase.hpp"
 #include "QGA_bits/CandidateFactory.hpp"
 #include "QGA_bits/GenOpCounter.hpp"
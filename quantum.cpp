@@ -23,6 +23,10 @@
   #endif
 #elif defined(SEARCH)
   #include "QGA_Problem/Search.hpp"
+#elif defined(STATEPREP)
+  #include "QGA_Problem/StatePrep.hpp"
+#elif defined(UNITARY)
+  #include "QGA_Problem/Unitary.hpp"
 #else
   #include "QGA_Problem/Simple.hpp"
 #endif
@@ -54,6 +58,58 @@ namespace Config {
   // NB: 1 is always added to slice length
   double expSliceLength = 2.0;
 
+  // Persistent fitness cache shared between runs (none if empty)
+  std::string cacheFile{};
+
+  // Curriculum: final circuit width (no curriculum if not above nBit)
+  unsigned finalBit = 0;
+
+  // Curriculum: error at which to continue with one more qubit
+  double liftError = 0.01;
+
+  // Stop evaluating new candidates once dominated by the archive
+  bool bounded = false;
+
+  // Number of random probes for estimating fitness (0 = exact only)
+  unsigned estProbes = 0;
+
+  // Error margin for candidates to pass the estimate to exact evaluation
+  double estMargin = 0.05;
+
+  // Number of children made of each selected parent (1 = independently)
+  size_t broodSize = 1;
+
+  // Candidates longer than this are not evaluated
+  size_t maxLength = 1000;
+
+  // Limit on length of new candidates relative to the front (0 = none)
+  double lengthFactor = 0;
+
+  // Gate applications allowed per generation in evaluation (0 = no limit)
+  size_t genBudget = 0;
+
+  // Input file of the problem, if it needs one
+  std::string dataFile{};
+
+  // Candidates to include in the initial population (none if empty)
+  std::string seedFile{};
+
+  // File to save the final front to (none if empty)
+  std::string saveFile{};
+
+  // Aggregate errors over several outputs using mean rather than maximum
+  bool meanError = false;
+
+  // Number of noisy trajectories per candidate (0 = noiseless)
+  unsigned noiseTraj = 0;
+
+  // Depolarizing noise rates per qubit after 1-qubit and other gates
+  double noiseDepol1 = 0.001;
+  double noiseDepol2 = 0.01;
+
+  // Dephasing noise rate per qubit after any gate
+  double noiseDephase = 0;
+
   // How much each bit is likely to be a control bit at gate creation
   const double pControl = 0.5;
 
@@ -63,6 +119,27 @@ namespace Config {
   // Standard deviation of mutation in gate angles
   const double dAlpha = 0.2;
 
+  // Number of random input states used for functional fingerprints
+  const unsigned fpProbes = 2;
+
+  // Number of L-BFGS iterations in the gradient optimization operator
+  const unsigned optSteps = 5;
+
+  // Fraction of estimate-based rejections to check using exact evaluation
+  const double pAudit = 0.05;
+
+  // Number of preceding gates a new gate may be moved past when simplifying
+  const size_t canonWindow = 8;
+
+  // Modules: number of gates, minimum number of front members sharing them
+  const size_t moduleLength = 4;
+  const size_t moduleMinCount = 3;
+
+  // Modules: maximum width, size of the library, generations between tries
+  const unsigned moduleQubits = 3;
+  const size_t moduleMax = 32;
+  const unsigned long moduleEvery = 10;
+
   // Maximum length of an output line when formatting circuits
   const size_t circLineLength = 220;
 
@@ -128,6 +205,42 @@ int main(int argc, char* argv[]) {
         Config::expMutationCount, &Config::expMutationCount);
     op.add<popl::Value<double>>("l", "slice", "expected slice length (minus 1)",
         Config::expSliceLength, &Config::expSliceLength);
+    op.add<popl::Value<std::string>>("c", "cache", "persistent cache file",
+        Config::cacheFile, &Config::cacheFile);
+    op.add<popl::Value<unsigned>>("f", "final", "final number of qubits",
+        Config::finalBit, &Config::finalBit);
+    op.add<popl::Value<double>>("L", "lift", "error for adding a qubit",
+        Config::liftError, &Config::liftError);
+    op.add<popl::Switch>("B", "bounded", "stop evaluating dominated candidates",
+        &Config::bounded);
+    op.add<popl::Value<unsigned>>("e", "estimate", "probes to estimate fitness",
+        Config::estProbes, &Config::estProbes);
+    op.add<popl::Value<double>>("E", "margin", "margin of estimated fitness",
+        Config::estMargin, &Config::estMargin);
+    op.add<popl::Value<size_t>>("k", "brood", "children per selected parent",
+        Config::broodSize, &Config::broodSize);
+    op.add<popl::Value<size_t>>("M", "maxlen", "maximum circuit length",
+        Config::maxLength, &Config::maxLength);
+    op.add<popl::Value<double>>("r", "ratio", "max. length relative to front",
+        Config::lengthFactor, &Config::lengthFactor);
+    op.add<popl::Value<size_t>>("G", "budget", "gate applications per gen",
+        Config::genBudget, &Config::genBudget);
+    op.add<popl::Value<std::string>>("d", "data", "problem data file",
+        Config::dataFile, &Config::dataFile);
+    op.add<popl::Value<std::string>>("S", "seed", "initial candidates file",
+        Config::seedFile, &Config::seedFile);
+    op.add<popl::Value<std::string>>("o", "save", "file to save the front to",
+        Config::saveFile, &Config::saveFile);
+    op.add<popl::Switch>("A", "mean", "mean instead of max error",
+        &Config::meanError);
+    op.add<popl::Value<unsigned>>("t", "traj", "noisy trajectories per circuit",
+        Config::noiseTraj, &Config::noiseTraj);
+    op.add<popl::Value<double>>("D", "depol", "depolarizing rate, 1-qubit",
+        Config::noiseDepol1, &Config::noiseDepol1);
+    op.add<popl::Value<double>>("C", "cdepol", "depolarizing rate, others",
+        Config::noiseDepol2, &Config::noiseDepol2);
+    op.add<popl::Value<double>>("Z", "dephase", "dephasing rate",
+        Config::noiseDephase, &Config::noiseDephase);
 
     bool help;
     op.add<popl::Switch>("h", "help", "show this help message", &help);
@@ -156,14 +269,74 @@ int main(int argc, char* argv[]) {
   }
 #endif
 
+  /* Build the tables which don't depend on the candidate */
+  try {
+    Candidate::precompute();
+  } catch(const std::runtime_error& e) {
+    std::cerr << e.what() << '\n';
+    return 1;
+  }
+
+  /* Open the persistent cache if requested */
+  if(!Config::cacheFile.empty()) {
+    try {
+      QGA::DiskCache::global() =
+        QGA::DiskCache{Config::cacheFile, Candidate::name()};
+    } catch(const std::runtime_error& e) {
+      std::cerr << e.what() << '\n';
+      return 1;
+    }
+  }
+
+  /* Read the seed candidates if requested */
+  std::vector<Candidate> seeds{};
+  if(!Config::seedFile.empty()) {
+    try {
+      seeds = Candidate::load(Config::seedFile);
+    } catch(const std::runtime_error& e) {
+      std::cerr << e.what() << '\n';
+      return 1;
+    }
+    std::cout << Colours::bold("Read ", seeds.size(), " candidates from ",
+        Config::seedFile) << std::endl;
+  }
+
+  /* The initial population: the seeds, topped up with random candidates */
+  auto initial = [&seeds]() -> Population {
+    Population ret{Config::popSize > seeds.size()
+      ? Config::popSize - seeds.size() : 0,
+      [] { return CandidateFactory::genInit().setGen(0); }};
+    for(const Candidate& c : seeds)
+      ret.add(Candidate{c}.setGen(0));
+    return ret;
+  };
+
   /* Initialize state variables */
   std::chrono::time_point<std::chrono::steady_clock>
     start{std::chrono::steady_clock::now()};
-  Population pop{Config::popSize,
-    [] { return CandidateFactory::genInit().setGen(0); }};
+  Population pop = initial();
   GenOpCounter trk{};
   unsigned long total_count = 0;
   unsigned long gen;
+  const unsigned nBitIni = Config::nBit;
+
+  /* Changes the circuit width and rebuilds the tables. If the problem can't
+   * be set up for the new width (e.g., if it is fixed by the data file),
+   * reports why, restores the previous width and stops the run. */
+  auto setWidth = [](unsigned n) -> bool {
+    unsigned old = Config::nBit;
+    Config::nBit = n;
+    try {
+      Candidate::precompute();
+      return true;
+    } catch(const std::runtime_error& e) {
+      std::cerr << e.what() << '\n';
+      Config::nBit = old;
+      Candidate::precompute();
+      Signal::state = Signal::STOPPING;
+      return false;
+    }
+  };
 
   /* Main loop */
   for(gen = 0; Config::maxGen == 0 || gen <= Config::maxGen; gen++) {
@@ -185,24 +358,64 @@ int main(int argc, char* argv[]) {
     /* Top up to popSize candidates in parallel */
     CandidateFactory cf{pop};
     pop.precompute();
+    if(Config::bounded || Config::estProbes > 0)
+      Candidate::setFrontier(pop2);
+    Candidate::setBudget(pop2);
     size_t topup_count = Config::popSize - pop2.size();
-    pop2.add(topup_count, [&] { return cf.getNew().setGen(gen); });
+    if(Config::broodSize > 1) {
+      /* Evaluate each brood in one go while the shared simulation of its
+       * parent is at hand, see CandidateFactory::getBrood() */
+      size_t nBroods = (topup_count + Config::broodSize - 1)
+        / Config::broodSize;
+      std::vector<std::vector<GenCandidate>> broods(nBroods);
+      /* Each thread draws from its own RNG, so a benchmark needs a fixed
+       * assignment of broods to threads */
+#ifdef GENETIC_OPENMP_REPRODUCIBLE
+      #pragma omp parallel for schedule(static)
+#else
+      #pragma omp parallel for schedule(dynamic)
+#endif
+      for(size_t j = 0; j < nBroods; j++)
+        for(Candidate& c : cf.getBrood(Config::broodSize)) {
+          GenCandidate gc{std::move(c.setGen(gen))};
+          gc.fitness();
+          gc.dropCheckpoint();
+          broods[j].push_back(std::move(gc));
+        }
+      for(const auto& brood : broods)
+        for(const GenCandidate& gc : brood)
+          pop2.add(gc);
+      topup_count = nBroods * Config::broodSize;
+    } else
+      pop2.add(topup_count, [&] { return cf.getNew().setGen(gen); });
     total_count += topup_count;
+    Candidate::clearFrontier();
+    Candidate::clearBudget();
 
     /* We don't need the original population anymore */
     pop = std::move(pop2);
 
     /* Leave only one representative of each fitness and drop dominated
-     * versions of the same circuit */
+     * versions of the same circuit or of functionally equivalent circuits.
+     * The latter have equal errors (the first element of fitness), which
+     * saves checking most pairs. */
     pop.prune([](const GenCandidate& a, const GenCandidate& b) -> int {
         if(a.fitness() == b.fitness())
           return 1;//a.getGen() < b.getGen() ? 1 : -1;
         else if(sameCirc(a, b))
           return b << a ? -1 : 1;
+        else if(a.fitness().head() == b.fitness().head() && sameFunc(a, b))
+          return b << a ? -1 : a << b ? 1 : 0;
         else
           return 0;
       }, 0, false);
 
+#ifdef GENE_ARENA
+    /* Release the gates of the candidates dropped so far. The seeds are
+     * kept for initial() on a restart. */
+    Gene::sweep(pop, seeds);
+#endif
+
     /* Take a record which GenOps were successful in making good candidates */
     auto nondom = pop.front();
     for(auto& c : nondom)
@@ -221,6 +434,32 @@ int main(int argc, char* argv[]) {
         << circuit << std::endl;
     }
 
+#ifdef MODULES
+    /* Freeze a sub-circuit common in the front into a new module, and add
+     * the front's circuits using it in place of the original gates */
+    if(gen % Config::moduleEvery == 0) {
+      std::vector<Candidate> shorter =
+        Candidate::harvestModules<QGA::Gates::Module>(nondom);
+      for(auto& c : shorter)
+        pop.add(c.setGen(gen));
+      if(!shorter.empty())
+        std::cout << Colours::bold("New module, ", shorter.size(),
+            " candidates shortened") << std::endl;
+    }
+#endif
+
+    /* Curriculum: carry the front over to one more qubit */
+    if(Config::nBit < Config::finalBit
+        && pop.best().fitness().head() <= Config::liftError
+        && setWidth(Config::nBit + 1)) {
+      Population lifted{};
+      for(auto& c : nondom)
+        lifted.add(c.lift().setGen(gen));
+      pop = std::move(lifted);
+      std::cout << Colours::bold("Lifted ", pop.size(), " candidates to ",
+          Config::nBit, " qubits") << std::endl;
+    }
+
     /* Interrupted? */
     while(Signal::state == Signal::INTERRUPTED)
       switch(int_response(pop, gen)) {
@@ -228,8 +467,9 @@ int main(int argc, char* argv[]) {
           dumpResults(pop, trk, start, total_count, gen);
           break;
         case Signal::RESTART:
-          pop = Population{Config::popSize,
-            [&] { return CandidateFactory::genInit().setGen(0); }};
+          if(Config::nBit != nBitIni && !setWidth(nBitIni))
+            break;
+          pop = initial();
           trk.reset();
           total_count = 0;
           start = std::chrono::steady_clock::now();
@@ -242,6 +482,19 @@ int main(int argc, char* argv[]) {
   }
 
   dumpResults(pop, trk, start, total_count, gen);
+
+  /* Save the front if requested */
+  if(!Config::saveFile.empty()) {
+    auto nondom = pop.front();
+    try {
+      size_t count = Candidate::save(Config::saveFile, nondom);
+      std::cout << "Saved " << count << " of " << nondom.size()
+        << " nondominated candidates to " << Config::saveFile << '\n';
+    } catch(const std::runtime_error& e) {
+      std::cerr << e.what() << '\n';
+      return 1;
+    }
+  }
 }
 
 
@@ -265,6 +518,18 @@ void dumpResults(Population& pop, GenOpCounter& trk,
   /* Dump the operator statistics */
   std::cout << "\nGenetic operator success rates:\n" << trk;
 
+  /* Evaluations saved by recognizing circuits evaluated before */
+  std::cout << "\nError cache: " << Candidate::errorCache() << '\n';
+  if(QGA::DiskCache::global())
+    std::cout << "Persistent cache: " << QGA::DiskCache::global() << '\n';
+  if(Config::bounded || Config::estProbes > 0)
+    std::cout << "Bounded evaluation: " << Candidate::rejectCount()
+      << " candidates rejected early\n";
+  if(Config::estProbes > 0)
+    std::cout << "Estimated fitness: " << Candidate::screenStats() << '\n';
+  if(Candidate::budgetStats().skipped > 0)
+    std::cout << "Evaluation budget: " << Candidate::budgetStats() << '\n';
+
   /* Timing information */
   std::chrono::time_point<std::chrono::steady_clock>
     now{std::chrono::steady_clock::now()};